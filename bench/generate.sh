@@ -0,0 +1,19 @@
+#!/bin/sh
+# Writes a Quark file with the given number of small functions, each with a loop
+# Usage: generate.sh <functions> <file.qrk>
+set -e
+
+functions=$1
+file=$2
+
+awk -v functions="$functions" 'BEGIN {
+    for (i = 0; i < functions; ++i) {
+        printf "func int f%d(int n) {\n", i
+        printf "    int total = 0;\n"
+        printf "    for (int j = 0; j < n; j = j + 1) {\n"
+        printf "        total = total + j * %d;\n", i
+        printf "    }\n"
+        printf "    return total;\n"
+        printf "}\n\n"
+    }
+}' > "$file"
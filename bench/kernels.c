@@ -0,0 +1,87 @@
+// Times the Quark kernels from tests/programs/c_callers.qrk against the same kernels in C
+// Usage: kernels <rounds> <label>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+int64_t sum(const int64_t *values, int64_t length);
+double dot(const double *a, int64_t a_length, const double *b, int64_t b_length);
+void saxpy(double a, const double *x, int64_t x_length, double *y, int64_t y_length);
+
+int64_t c_sum(const int64_t *values, int64_t length);
+double c_dot(const double *a, const double *b, int64_t length);
+void c_saxpy(double a, const double *x, double *y, int64_t length);
+
+// Small enough to stay in the L2 cache, so the kernels and not the memory are measured
+#define LENGTH 4096
+
+static int64_t values[LENGTH];
+static double x[LENGTH];
+static double y[LENGTH];
+
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+static void report(const char *label, const char *kernel, double quark_time, double c_time, long rounds) {
+    const double elements = (double)rounds * LENGTH;
+    printf("%-8s %-6s quark %6.3f ns/element   C %6.3f ns/element   C/quark %5.2f\n",
+           label, kernel, quark_time * 1e9 / elements, c_time * 1e9 / elements, c_time / quark_time);
+}
+
+int main(int argc, char **argv) {
+    const long rounds = argc > 1 ? atol(argv[1]) : 100000;
+    const char *label = argc > 2 ? argv[2] : "";
+    for (int64_t i = 0; i < LENGTH; ++i) {
+        values[i] = i;
+        x[i] = 1.0 / (double)(i + 1);
+        y[i] = (double)i;
+    }
+
+    int64_t quark_sum = 0;
+    int64_t c_sum_result = 0;
+    double start = now();
+    for (long round = 0; round < rounds; ++round) {
+        quark_sum += sum(values, LENGTH);
+    }
+    double quark_time = now() - start;
+    start = now();
+    for (long round = 0; round < rounds; ++round) {
+        c_sum_result += c_sum(values, LENGTH);
+    }
+    report(label, "sum", quark_time, now() - start, rounds);
+
+    double quark_dot = 0.0;
+    double c_dot_result = 0.0;
+    start = now();
+    for (long round = 0; round < rounds; ++round) {
+        quark_dot += dot(x, LENGTH, y, LENGTH);
+    }
+    quark_time = now() - start;
+    start = now();
+    for (long round = 0; round < rounds; ++round) {
+        c_dot_result += c_dot(x, y, LENGTH);
+    }
+    report(label, "dot", quark_time, now() - start, rounds);
+
+    start = now();
+    for (long round = 0; round < rounds; ++round) {
+        saxpy(1e-9, x, LENGTH, y, LENGTH);
+    }
+    quark_time = now() - start;
+    start = now();
+    for (long round = 0; round < rounds; ++round) {
+        c_saxpy(-1e-9, x, y, LENGTH);
+    }
+    report(label, "saxpy", quark_time, now() - start, rounds);
+
+    // Both sides add in source order, so the results are identical
+    if (quark_sum != c_sum_result || quark_dot != c_dot_result) {
+        fprintf(stderr, "Quark and C kernels disagree\n");
+        return 1;
+    }
+    return 0;
+}
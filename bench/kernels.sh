@@ -0,0 +1,28 @@
+#!/bin/sh
+# Builds the array kernels of tests/programs/c_callers.qrk and the same kernels in C, once
+# for the baseline CPU (quark -mcpu=generic, cc -O2) and once for the host CPU (quark,
+# cc -O2 -march=native), and prints the time per element of each
+# Usage: kernels.sh <quark> [cc] [rounds]
+set -e
+
+quark=$1
+cc=${2:-cc}
+rounds=${3:-100000}
+root=$(cd "$(dirname "$0")/.." && pwd)
+work_dir=$(mktemp -d)
+trap 'rm -rf "$work_dir"' EXIT
+
+for target in generic native; do
+    if [ "$target" = generic ]; then
+        quark_flags=-mcpu=generic
+        cflags=-O2
+    else
+        quark_flags=
+        cflags="-O2 -march=native"
+    fi
+    "$quark" "$root/tests/programs/c_callers.qrk" -o "$work_dir/quark_$target.o" $quark_flags > /dev/null
+    "$cc" $cflags -c "$root/bench/kernels_c.c" -o "$work_dir/c_$target.o"
+    "$cc" -O2 "$root/bench/kernels.c" "$work_dir/quark_$target.o" "$work_dir/c_$target.o" \
+        -o "$work_dir/kernels_$target"
+    "$work_dir/kernels_$target" "$rounds" "$target"
+done
@@ -0,0 +1,25 @@
+// The kernels of tests/programs/c_callers.qrk written in C, compiled on their own so the
+// benchmark cannot inline them
+#include <stdint.h>
+
+int64_t c_sum(const int64_t *values, int64_t length) {
+    int64_t total = 0;
+    for (int64_t i = 0; i < length; ++i) {
+        total += values[i];
+    }
+    return total;
+}
+
+double c_dot(const double *a, const double *b, int64_t length) {
+    double total = 0.0;
+    for (int64_t i = 0; i < length; ++i) {
+        total += a[i] * b[i];
+    }
+    return total;
+}
+
+void c_saxpy(double a, const double *restrict x, double *restrict y, int64_t length) {
+    for (int64_t i = 0; i < length; ++i) {
+        y[i] = a * x[i] + y[i];
+    }
+}
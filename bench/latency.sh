@@ -0,0 +1,53 @@
+#!/bin/sh
+# Compiles the same small files once with a new quark process per file and once through a
+# running quarkd, and prints the average time per file of both
+# Usage: latency.sh <quark> <quarkd> [files] [functions per file]
+set -e
+
+quark=$1
+quarkd=$2
+files=${3:-50}
+functions=${4:-20}
+root=$(cd "$(dirname "$0")/.." && pwd)
+work_dir=$(mktemp -d)
+server_pid=
+cleanup() {
+    if [ -n "$server_pid" ]; then
+        kill "$server_pid" 2> /dev/null || true
+        wait "$server_pid" 2> /dev/null || true
+    fi
+    rm -rf "$work_dir"
+}
+trap cleanup EXIT
+
+i=0
+while [ $i -lt "$files" ]; do
+    "$root/bench/generate.sh" "$functions" "$work_dir/file$i.qrk"
+    i=$((i + 1))
+done
+
+# Runs quark on every file with the given extra arguments, prints the milliseconds per file
+per_file() {
+    start=$(date +%s%N)
+    i=0
+    while [ $i -lt "$files" ]; do
+        "$quark" "$work_dir/file$i.qrk" -o "$work_dir/file$i.o" "$@" > /dev/null
+        i=$((i + 1))
+    done
+    end=$(date +%s%N)
+    echo "$(( (end - start) / 1000 / files ))" | awk '{ printf "%.2f", $1 / 1000 }'
+}
+
+echo "$files files of $functions functions"
+echo "quark per file:          $(per_file) ms"
+
+"$quarkd" "$work_dir/quarkd.sock" > "$work_dir/quarkd.log" 2>&1 &
+server_pid=$!
+while [ ! -S "$work_dir/quarkd.sock" ]; do
+    if ! kill -0 "$server_pid" 2> /dev/null; then
+        cat "$work_dir/quarkd.log" >&2
+        exit 1
+    fi
+    sleep 0.1
+done
+echo "quark --server per file: $(per_file --server="$work_dir/quarkd.sock") ms"
@@ -0,0 +1,35 @@
+#!/bin/sh
+# Compiles generated files of growing size without a memory budget and with a few budgets
+# and prints the peak resident set size of every compilation, one line per file and budget
+# Usage: memory.sh <quark> [cc] [function counts...]
+set -e
+
+quark=$1
+cc=${2:-cc}
+shift
+if [ $# -gt 0 ]; then
+    shift
+fi
+counts=${*:-1000 4000 16000}
+budgets="none 64M 16M 1M"
+root=$(cd "$(dirname "$0")/.." && pwd)
+work_dir=$(mktemp -d)
+trap 'rm -rf "$work_dir"' EXIT
+
+"$cc" -O2 "$root/bench/peak_rss.c" -o "$work_dir/peak_rss"
+
+printf '%10s %12s %8s %14s %10s\n' functions bytes budget "peak RSS MiB" "time ms"
+for count in $counts; do
+    "$root/bench/generate.sh" "$count" "$work_dir/input.qrk"
+    bytes=$(wc -c < "$work_dir/input.qrk")
+    for budget in $budgets; do
+        flags=
+        if [ "$budget" != none ]; then
+            flags=--max-memory=$budget
+        fi
+        start=$(date +%s%N)
+        peak=$("$work_dir/peak_rss" "$quark" "$work_dir/input.qrk" -o "$work_dir/output.o" $flags 2>&1 > /dev/null | tail -n 1)
+        end=$(date +%s%N)
+        printf '%10s %12s %8s %14s %10s\n' "$count" "$bytes" "$budget" $(( peak / 1024 )) $(( (end - start) / 1000000 ))
+    done
+done
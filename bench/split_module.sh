@@ -0,0 +1,30 @@
+#!/bin/sh
+# Compiles a generated file with many functions once per thread count and prints the wall
+# time of each, the module is split into the same partitions every time
+# Usage: split_module.sh <quark> [functions] [thread counts...]
+set -e
+
+quark=$1
+functions=${2:-50000}
+shift
+if [ $# -gt 0 ]; then
+    shift
+fi
+threads=${*:-1 2 4 8}
+root=$(cd "$(dirname "$0")/.." && pwd)
+work_dir=$(mktemp -d)
+trap 'rm -rf "$work_dir"' EXIT
+
+"$root/bench/generate.sh" "$functions" "$work_dir/split.qrk"
+echo "$functions functions, $(wc -c < "$work_dir/split.qrk") bytes, $(nproc) cores"
+
+for count in $threads; do
+    start=$(date +%s%N)
+    "$quark" "$work_dir/split.qrk" -o "$work_dir/split_$count.o" -j "$count" > /dev/null
+    end=$(date +%s%N)
+    echo "-j $count: $(( (end - start) / 1000000 )) ms"
+    if ! cmp -s "$work_dir/split_$count.o" "$work_dir/split_$(echo "$threads" | cut -d' ' -f1).o"; then
+        echo "the object built with -j $count differs" >&2
+        exit 1
+    fi
+done
@@ -0,0 +1,38 @@
+#!/bin/sh
+# Times bench/tail_calls.qrk with guaranteed tail calls against the naive lowering
+# (--no-tail-calls), where every call pushes a frame. Every function is compiled in its own
+# batch, so the optimizer cannot fold the recursion and the calls are measured
+# Usage: tail_calls.sh <quark> [cc]
+set -e
+
+quark=$1
+cc=${2:-cc}
+root=$(cd "$(dirname "$0")/.." && pwd)
+work_dir=$(mktemp -d)
+trap 'rm -rf "$work_dir"' EXIT
+ulimit -s 8192
+
+# Fastest of three runs in milliseconds
+fastest() {
+    best=
+    for attempt in 1 2 3; do
+        start=$(date +%s%N)
+        "$1"
+        end=$(date +%s%N)
+        time=$(( (end - start) / 1000000 ))
+        if [ -z "$best" ] || [ "$time" -lt "$best" ]; then
+            best=$time
+        fi
+    done
+    echo "$best"
+}
+
+for lowering in tail naive; do
+    flags=--max-memory=1K
+    if [ "$lowering" = naive ]; then
+        flags="$flags --no-tail-calls"
+    fi
+    "$quark" "$root/bench/tail_calls.qrk" -o "$work_dir/$lowering.o" $flags > /dev/null
+    "$cc" "$work_dir/$lowering.o" -o "$work_dir/$lowering"
+    echo "$lowering calls: $(fastest "$work_dir/$lowering") ms"
+done
@@ -0,0 +1,82 @@
+#include "lexer.hpp"
+#include "constants.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Lexing is linear, so lexing the input repeated REPEATS times may take at most
+// MAX_GROWTH times as long as lexing the input itself REPEATS times. A lexer that is
+// superlinear somewhere takes about REPEATS times longer than that. MIN_DURATION absorbs
+// the timer noise of inputs that are lexed in microseconds
+constexpr std::size_t REPEATS = 16;
+constexpr std::int64_t MAX_GROWTH = 4;
+constexpr std::chrono::nanoseconds MIN_DURATION = std::chrono::milliseconds(1);
+// Every measurement is the fastest of a few attempts, to rule out preemption
+constexpr int ATTEMPTS = 3;
+
+auto lex(const std::string &source) -> std::chrono::nanoseconds {
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        Lexer lexer(source);
+        while (lexer.get_next_token().type != TokenType::END_OF_FILE) {}
+    }
+    catch (const std::runtime_error &) {
+        // Invalid input is expected to be rejected
+    }
+    return std::chrono::steady_clock::now() - start;
+}
+
+auto fastest_lex(const std::string &source) -> std::chrono::nanoseconds {
+    std::chrono::nanoseconds fastest = lex(source);
+    for (int attempt = 1; attempt < ATTEMPTS; ++attempt) {
+        fastest = std::min(fastest, lex(source));
+    }
+    return fastest;
+}
+
+void check_lexing_growth(const std::string &source) {
+    // Line comments end at the newline, so every copy is lexed the same way
+    std::string repeated;
+    repeated.reserve((source.size() + 1) * REPEATS);
+    for (std::size_t i = 0; i < REPEATS; ++i) {
+        repeated += source;
+        repeated += '\n';
+    }
+
+    const std::chrono::nanoseconds single = fastest_lex(source);
+    const std::chrono::nanoseconds limit = MIN_DURATION + single * static_cast<std::int64_t>(REPEATS) * MAX_GROWTH;
+    std::chrono::nanoseconds whole = lex(repeated);
+    for (int attempt = 1; attempt < ATTEMPTS && whole > limit; ++attempt) {
+        whole = std::min(whole, lex(repeated));
+    }
+
+    if (whole > limit) {
+        std::fprintf(stderr, "Superlinear lexing time: %lld ns for %zu bytes but %lld ns for %zu bytes\n",
+                     static_cast<long long>(single.count()), source.size(),
+                     static_cast<long long>(whole.count()), repeated.size());
+        std::abort();
+    }
+}
+
+} // namespace
+
+extern "C" auto LLVMFuzzerTestOneInput(const std::uint8_t *data, std::size_t size) -> int {
+    static const bool logger_disabled = [] {
+        QuarkLogger::get_instance()->set_level(Level::OFF);
+        return true;
+    }();
+    (void)logger_disabled;
+
+    const std::string source(reinterpret_cast<const char*>(data), size);
+    check_lexing_growth(source);
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include "constants.hpp"
+
+#include <fstream>
+#include <iostream>
+
+// Writes a libFuzzer dictionary with every keyword and multi character token
+auto main(int argc, char* argv[]) -> int {
+    if (argc != 2) {
+        std::cerr << "Usage: make_dictionary <output file>\n";
+        return 1;
+    }
+
+    std::ofstream dictionary(argv[1]);
+    if (!dictionary.is_open()) {
+        std::cerr << "Error: Failed to open " << argv[1] << '\n';
+        return 1;
+    }
+
+    for (const auto& [keyword, token_type] : keyword_map) {
+        dictionary << '"' << keyword << "\"\n";
+    }
+    for (const auto& [token, token_type] : multi_char_token_map) {
+        dictionary << '"' << token << "\"\n";
+    }
+
+    // Comment markers are not tokens but the lexer special cases them
+    for (const char *marker : {"//", "/*", "*/"}) {
+        dictionary << '"' << marker << "\"\n";
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+#include "parser.hpp"
+#include "lexer.hpp"
+#include "utils.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+extern "C" auto LLVMFuzzerTestOneInput(const std::uint8_t *data, std::size_t size) -> int {
+    static const bool logger_disabled = [] {
+        QuarkLogger::get_instance()->set_level(Level::OFF);
+        return true;
+    }();
+    (void)logger_disabled;
+
+    QuarkParser parser(std::make_unique<Lexer>(std::string(reinterpret_cast<const char*>(data), size)));
+    try {
+        parser.parse_code();
+    }
+    catch (const std::runtime_error &) {
+        // Invalid programs are expected to be rejected, anything else is a bug
+    }
+    return 0;
+}
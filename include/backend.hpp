@@ -0,0 +1,88 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/Support/PGOOptions.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/ADT/Optional.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+enum class PgoMode : std::uint8_t {
+    NONE,
+    GENERATE,   // Instrument the IR, counts are written to the profile file at exit
+    USE         // Feed an indexed profile (.profdata) back into the pipeline
+};
+
+struct BackendOptions {
+    PgoMode pgo_mode = PgoMode::NONE;
+    std::string pgo_profile_file;
+    bool vectorize_report = false;  // Print the loop vectorizer's optimization remarks
+    unsigned threads = 0;           // Threads used for large modules, 0 uses every core
+    std::string cpu = "native";     // Target CPU, "native" is the host CPU with all its features
+    bool tail_calls = true;         // Read by code generation, false lowers every call as a plain call
+};
+
+// Optimizes and emits an LLVM module for the host's target triple and the configured CPU.
+// Target machines and the thread pool are kept for the lifetime of the backend, so one
+// backend can serve many compilations, also concurrently
+class QuarkBackend {
+private:
+    BackendOptions m_options;
+    std::unique_ptr<llvm::TargetMachine> m_target_machine;
+
+    // A target machine can only be used by one thread at a time, idle ones wait here
+    mutable std::mutex m_target_machines_mutex;
+    mutable std::vector<std::unique_ptr<llvm::TargetMachine>> m_target_machines;
+    mutable llvm::ThreadPool m_thread_pool;
+
+    static void initialize_targets();
+    auto create_target_machine() const -> std::unique_ptr<llvm::TargetMachine>;
+    auto acquire_target_machine() const -> std::unique_ptr<llvm::TargetMachine>;
+    void release_target_machine(std::unique_ptr<llvm::TargetMachine> target_machine) const;
+    auto create_pgo_options() const -> llvm::Optional<llvm::PGOOptions>;
+
+    void optimize(llvm::Module &module, llvm::TargetMachine &target_machine) const;
+    static void emit_object(llvm::Module &module, llvm::TargetMachine &target_machine,
+                            llvm::raw_pwrite_stream &dest);
+    static auto emit_to_buffer(llvm::Module &module, llvm::TargetMachine &target_machine)
+        -> std::unique_ptr<llvm::MemoryBuffer>;
+    static auto partition_count(const llvm::Module &module) -> unsigned;
+    auto compile_partition(const llvm::SmallVector<char, 0> &bitcode, unsigned index) const
+        -> std::unique_ptr<llvm::MemoryBuffer>;
+
+public:
+    QuarkBackend(BackendOptions options);
+
+    QuarkBackend(const QuarkBackend&) = delete;
+    auto operator=(const QuarkBackend&) -> QuarkBackend& = delete;
+    QuarkBackend(QuarkBackend&&) = delete;
+    auto operator=(QuarkBackend&&) -> QuarkBackend& = delete;
+    ~QuarkBackend() = default;
+
+    [[nodiscard]] auto options() const -> const BackendOptions& {
+        return m_options;
+    }
+
+    // Sets the target triple and data layout of the module to the host's
+    void prepare_module(llvm::Module &module) const;
+    void optimize(llvm::Module &module) const;
+
+    // Optimizes and emits the module, large modules are split with SplitModule and the
+    // partitions compiled in parallel, each partition then becomes its own object
+    auto compile_to_buffers(llvm::Module &module) const -> std::vector<std::unique_ptr<llvm::MemoryBuffer>>;
+
+    // Optimizes and emits the module on the calling thread into memory
+    auto compile_to_buffer(llvm::Module &module) const -> std::unique_ptr<llvm::MemoryBuffer>;
+
+    // A single object is kept as is and several are merged into one relocatable object
+    static auto merge_objects(std::vector<std::unique_ptr<llvm::MemoryBuffer>> objects)
+        -> std::unique_ptr<llvm::MemoryBuffer>;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "constants.hpp"
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Type.h>
+#include <llvm/IR/Value.h>
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class PrototypeAst;
+
+// Arrays are passed as a data pointer and their length
+struct ArrayValue {
+    llvm::Value *data = nullptr;
+    llvm::Value *length = nullptr;
+    QuarkType element_type = QuarkType::FLOAT;
+};
+
+// State shared by the AST nodes while generating code for one module
+struct CodegenContext {
+    llvm::Module &module;
+    llvm::IRBuilder<> builder;
+    std::unordered_map<std::string, llvm::AllocaInst*> named_values;
+    std::unordered_map<std::string, ArrayValue> arrays;
+
+    // Functions that can be called, declared in the module the first time they are used
+    std::unordered_map<std::string, PrototypeAst*> prototypes;
+
+    // Functions with a body in the file, calls to them go to the tailcc body
+    std::unordered_set<std::string> defined_functions;
+
+    // Self-recursive tail calls store the new arguments into the slots (null for
+    // array arguments) and jump back to this block
+    llvm::BasicBlock *tail_recursion_block = nullptr;
+    std::vector<llvm::AllocaInst*> argument_slots;
+
+    // Without tail calls every call is a plain C call that is never turned into a jump or a
+    // loop, the naive lowering that guaranteed tail calls are measured against
+    bool tail_calls = true;
+
+    CodegenContext(llvm::Module &target_module)
+    : module(target_module), builder(target_module.getContext()) {}
+
+    static auto body_name(const std::string &function_name) -> std::string;
+    // Types of variables and arguments, void is only valid as a return type
+    auto get_type(QuarkType type) -> llvm::Type*;
+    auto get_return_type(QuarkType type) -> llvm::Type*;
+    static auto is_array(QuarkType type) -> bool;
+    static auto element_type(QuarkType array_type) -> QuarkType;
+
+    // Allocas are created in the entry block so mem2reg/SROA can promote them
+    auto create_entry_block_alloca(llvm::Function *function, const std::string &name,
+                                   llvm::Type *type) -> llvm::AllocaInst*;
+    auto convert(llvm::Value *value, llvm::Type *type) -> llvm::Value*;
+    auto to_condition(llvm::Value *value) -> llvm::Value*;
+    auto create_loop_metadata() -> llvm::MDNode*;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "backend.hpp"
+
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Entry point of libquark. An instance initializes LLVM once and keeps its backend, with
+// the target machines and thread pool, warm across compilations, so a build server can
+// reuse it for every file it compiles. compile may be called from several threads at once
+class CompilerInstance {
+private:
+    QuarkBackend m_backend;
+    std::size_t m_max_memory;
+
+public:
+    // A max_memory above zero compiles one batch of functions at a time, see StreamingCompiler
+    CompilerInstance(BackendOptions options, std::size_t max_memory = 0);
+
+    // Compiles the source held in memory, name is used as the module identifier. Returns
+    // a single relocatable object, also when the module was split into partitions
+    auto compile(const std::string &source, const std::string &name) const -> std::unique_ptr<llvm::MemoryBuffer>;
+    void compile_file(const std::string &input_file, const std::string &output_file) const;
+};
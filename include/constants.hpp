@@ -91,3 +91,13 @@ inline const std::unordered_map<std::string, TokenType> keyword_map = {
     {"char", TokenType::CHAR_KEYWORD},
     {"bool", TokenType::BOOL_KEYWORD},
 };
+
+// Types of Quark values, arrays are contiguous and carry their length with them
+enum class QuarkType : std::uint8_t {
+    VOID,
+    INT,
+    FLOAT,
+    BOOL,
+    INT_ARRAY,
+    FLOAT_ARRAY
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "compiler.hpp"
+
+#include <string>
+
+// Local compile server, quark --server=<socket> hands its file to a running quarkd instead
+// of initializing a compiler of its own. One request per connection: the input and output
+// paths, each terminated by a newline. Once the object is written the server replies
+// "ok\n", or "error: <message>\n" if the compilation failed
+class CompileServer {
+private:
+    const CompilerInstance &m_compiler;
+    std::string m_socket_path;
+    unsigned m_workers;
+    int m_socket = -1;
+
+    void handle_connection(int connection) const;
+
+public:
+    // Binds and listens on the socket. A stale socket left by a server that exited is
+    // replaced, but the constructor throws if a server still answers or the path is not a socket.
+    // At most workers requests are compiled at once, 0 uses one worker per core
+    CompileServer(const CompilerInstance &compiler, std::string socket_path, unsigned workers = 0);
+    ~CompileServer();
+
+    CompileServer(const CompileServer&) = delete;
+    auto operator=(const CompileServer&) -> CompileServer& = delete;
+    CompileServer(CompileServer&&) = delete;
+    auto operator=(CompileServer&&) -> CompileServer& = delete;
+
+    // Accepts connections until the process exits. Requests are compiled by the workers,
+    // connections beyond that wait in a short queue and then in the socket's backlog
+    void serve() const;
+};
+
+// Sends a compile request to the server, relative paths are resolved against the caller's
+// working directory. Throws with the server's message if the compilation failed
+void request_compile(const std::string &socket_path, const std::string &input_file,
+                     const std::string &output_file);
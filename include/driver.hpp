@@ -0,0 +1,43 @@
+#pragma once
+
+#include "backend.hpp"
+#include "codegen.hpp"
+#include "linker.hpp"
+#include "parser.hpp"
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Compiles a file while holding at most a batch of top level functions in memory.
+// A first pass collects every prototype while skipping the function bodies, so functions
+// can be called before they are defined, just like when the whole file is parsed at once.
+// Then functions are parsed and generated into the current batch until the estimated
+// memory of the batch exceeds the budget, and the batch is optimized, emitted and freed
+// along with its ASTs and context. Only prototypes outlive their function
+class StreamingCompiler {
+private:
+    const QuarkBackend &m_backend;
+    std::size_t m_max_memory;
+
+    std::unique_ptr<llvm::LLVMContext> m_context;
+    std::unique_ptr<llvm::Module> m_module;
+    std::unique_ptr<CodegenContext> m_codegen;
+    size_t m_batch_functions = 0;
+    size_t m_batch_instructions = 0;
+    size_t m_batches = 0;
+
+    void start_batch(const std::string &name);
+    void flush_batch(ObjectLinker &objects);
+
+public:
+    StreamingCompiler(const QuarkBackend &backend, std::size_t max_memory)
+    : m_backend(backend), m_max_memory(max_memory) {}
+
+    // Each batch's object is handed to objects as soon as it is emitted, name is used for
+    // the batch modules
+    void compile(const std::string &source, const std::string &name, ObjectLinker &objects);
+};
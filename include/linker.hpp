@@ -0,0 +1,34 @@
+#pragma once
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Combines objects into one relocatable object with the system linker (ld -r), so the
+// output is a single object no matter how many partitions or batches a file was compiled
+// in. Objects are written to a temporary directory as they are added, so they do not
+// have to stay in memory until the end
+class ObjectLinker {
+private:
+    llvm::SmallString<128> m_directory;
+    std::vector<std::string> m_object_files;
+
+public:
+    ObjectLinker() = default;
+    ~ObjectLinker();
+
+    ObjectLinker(const ObjectLinker&) = delete;
+    auto operator=(const ObjectLinker&) -> ObjectLinker& = delete;
+    ObjectLinker(ObjectLinker&&) = delete;
+    auto operator=(ObjectLinker&&) -> ObjectLinker& = delete;
+
+    void add(const llvm::MemoryBuffer &object);
+    [[nodiscard]] auto size() const -> size_t { return m_object_files.size(); }
+
+    // A single object is copied as is, several are linked into one
+    void link(const std::string &output_file) const;
+    [[nodiscard]] auto link_to_buffer() -> std::unique_ptr<llvm::MemoryBuffer>;
+};
@@ -3,6 +3,7 @@
 #include "constants.hpp"
 #include "lexer.hpp"
 
+#include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Value.h>
 
 #include <string>
@@ -10,13 +11,16 @@
 #include <memory>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <cstdint>
 
+struct CodegenContext;
+
 // Interface class for an expression AST
 class ExprAst {
 public:
     ExprAst() = default;
-    virtual auto generate_code() -> llvm::Value*;
+    virtual auto generate_code(CodegenContext &context) -> llvm::Value* = 0;
 
     virtual ~ExprAst() = default;
 
@@ -34,7 +38,29 @@ private:
 
 public:
     NumberExprAst(double val) : m_val(val) {}
-    auto generate_code() -> llvm::Value* override;
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
+};
+
+
+// For integers, kept apart from floats so loop counters and indices stay integral
+class IntegerExprAst : public ExprAst {
+private:
+    std::int64_t m_val;
+
+public:
+    IntegerExprAst(std::int64_t val) : m_val(val) {}
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
+};
+
+
+// For true and false
+class BoolExprAst : public ExprAst {
+private:
+    bool m_val;
+
+public:
+    BoolExprAst(bool val) : m_val(val) {}
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
 };
 
 
@@ -45,22 +71,136 @@ private:
 
 public:
     VariableExprAst(std::string name): m_name(std::move(name)) {}
-    auto generate_code() -> llvm::Value* override;
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
+
+    [[nodiscard]] auto get_name() const -> const std::string& { return m_name; }
+};
+
+
+// For variable declarations (int n = 1;)
+class VarDeclExprAst : public ExprAst {
+private:
+    std::string m_name;
+    QuarkType m_type;
+    std::unique_ptr<ExprAst> m_init;
+
+public:
+    VarDeclExprAst(std::string name, QuarkType type, std::unique_ptr<ExprAst> init)
+    : m_name(std::move(name)), m_type(type), m_init(std::move(init)) {}
+
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
 };
 
 
-// For binary operators 
+// For indexing into an array (a[i])
+class ArrayIndexExprAst : public ExprAst {
+private:
+    std::string m_name;
+    std::unique_ptr<ExprAst> m_index;
+
+    auto element_pointer(CodegenContext &context) -> std::pair<llvm::Value*, llvm::Type*>;
+
+public:
+    ArrayIndexExprAst(std::string name, std::unique_ptr<ExprAst> index)
+    : m_name(std::move(name)), m_index(std::move(index)) {}
+
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
+    auto generate_store(CodegenContext &context, llvm::Value *value) -> llvm::Value*;
+};
+
+
+// For the length of an array, known at runtime as the array travels with it
+class ArrayLengthExprAst : public ExprAst {
+private:
+    std::string m_name;
+
+public:
+    ArrayLengthExprAst(std::string name): m_name(std::move(name)) {}
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
+};
+
+
+// For binary operators, assignment is TokenType::EQUALS
 class BinaryExprAst : public ExprAst {
 private:
-    char m_operator;
+    TokenType m_operator;
     std::unique_ptr<ExprAst> m_LHS, m_RHS;
 
+    auto generate_logical(CodegenContext &context) -> llvm::Value*;
+
 public:
-    BinaryExprAst(char oper, std::unique_ptr<ExprAst> LHS, 
+    BinaryExprAst(TokenType oper, std::unique_ptr<ExprAst> LHS, 
                   std::unique_ptr<ExprAst> RHS)
     : m_operator(oper), m_LHS(std::move(LHS)), m_RHS(std::move(RHS)) {}
 
-    auto generate_code() -> llvm::Value* override;
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
+};
+
+
+// For a sequence of expressions in braces, the block's locals go out of scope at its end
+class BlockExprAst : public ExprAst {
+private:
+    std::vector<std::unique_ptr<ExprAst>> m_body;
+
+public:
+    BlockExprAst(std::vector<std::unique_ptr<ExprAst>> body): m_body(std::move(body)) {}
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
+};
+
+
+// If statements, the else branch may be null
+class IfExprAst : public ExprAst {
+private:
+    std::unique_ptr<ExprAst> m_cond, m_then, m_else;
+
+public:
+    // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+    IfExprAst(std::unique_ptr<ExprAst> cond, std::unique_ptr<ExprAst> then_branch,
+              std::unique_ptr<ExprAst> else_branch)
+    : m_cond(std::move(cond)), m_then(std::move(then_branch)), m_else(std::move(else_branch)) {}
+
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
+};
+
+
+// For loops (for(init; cond; step) body), any of init, cond and step may be null
+class ForExprAst : public ExprAst {
+private:
+    std::unique_ptr<ExprAst> m_init, m_cond, m_step, m_body;
+
+public:
+    // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+    ForExprAst(std::unique_ptr<ExprAst> init, std::unique_ptr<ExprAst> cond,
+               std::unique_ptr<ExprAst> step, std::unique_ptr<ExprAst> body)
+    : m_init(std::move(init)), m_cond(std::move(cond)),
+      m_step(std::move(step)), m_body(std::move(body)) {}
+
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
+};
+
+
+// While loops (while(cond) body)
+class WhileExprAst : public ExprAst {
+private:
+    std::unique_ptr<ExprAst> m_cond, m_body;
+
+public:
+    // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+    WhileExprAst(std::unique_ptr<ExprAst> cond, std::unique_ptr<ExprAst> body)
+    : m_cond(std::move(cond)), m_body(std::move(body)) {}
+
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
+};
+
+
+// For returning from a function, the value is null for void functions
+class ReturnExprAst : public ExprAst {
+private:
+    std::unique_ptr<ExprAst> m_value;
+
+public:
+    ReturnExprAst(std::unique_ptr<ExprAst> value): m_value(std::move(value)) {}
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
 };
 
 
@@ -70,25 +210,60 @@ private:
     std::string m_callee;
     std::vector<std::unique_ptr<ExprAst>> m_args;
 
+    auto get_callee(CodegenContext &context) -> llvm::Function*;
+    auto generate_args(CodegenContext &context, llvm::Function *callee) -> std::vector<llvm::Value*>;
+
 public:
     CallExprAst(std::string callee, std::vector<std::unique_ptr<ExprAst>> args)
     : m_callee(std::move(callee)), m_args(std::move(args)) {}
 
-    auto generate_code() -> llvm::Value* override;
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
+
+    // Emits the call followed by the return, self-recursive calls become a jump
+    // back to the top of the function
+    auto generate_tail_call(CodegenContext &context) -> llvm::Value*;
 };
 
 
 // The "schema" of a function (name, args, etc.)
+// Array arguments are lowered to a noalias data pointer followed by the length,
+// so arrays passed to one call must not overlap.
+// A function defined in the file gets a hidden body using the tailcc convention, which
+// guarantees that calls in tail position between Quark functions do not grow the stack.
+// Its exported symbol is a C convention entry point calling the body, so C can call it
 class PrototypeAst : public ExprAst {
 private:
     std::string m_name;
     std::vector<std::string> m_args;
+    std::vector<QuarkType> m_arg_types;
+    QuarkType m_return_type;
+
+    auto create_function(CodegenContext &context, const std::string &symbol) -> llvm::Function*;
 
 public:
-    PrototypeAst(std::string name, std::vector<std::string> args)
-    : m_name(std::move(name)), m_args(std::move(args)) {}
+    PrototypeAst(std::string name, std::vector<std::string> args,
+                 std::vector<QuarkType> arg_types, QuarkType return_type)
+    : m_name(std::move(name)), m_args(std::move(args)),
+      m_arg_types(std::move(arg_types)), m_return_type(return_type) {}
 
-    auto generate_code() -> llvm::Value* override;
+    // Declares the function Quark code calls, the tailcc body for functions defined in the
+    // file and the C symbol for anything else
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
+
+    // Declares the C convention entry point of a function defined in the file
+    auto generate_entry(CodegenContext &context) -> llvm::Function*;
+
+    auto function_type(CodegenContext &context) const -> llvm::FunctionType*;
+
+    [[nodiscard]] auto get_name() const -> const std::string& { return m_name; }
+    [[nodiscard]] auto get_args() const -> const std::vector<std::string>& { return m_args; }
+    [[nodiscard]] auto get_arg_types() const -> const std::vector<QuarkType>& { return m_arg_types; }
+    [[nodiscard]] auto get_return_type() const -> QuarkType { return m_return_type; }
+
+    // Argument names may differ between declarations of one function, the types may not
+    [[nodiscard]] auto has_same_signature(const PrototypeAst &other) const -> bool {
+        return m_arg_types == other.m_arg_types && m_return_type == other.m_return_type;
+    }
 };
 
 
@@ -102,7 +277,9 @@ public:
     FunctionAst(std::unique_ptr<PrototypeAst> prototype, std::unique_ptr<ExprAst> body)
     : m_prototype(std::move(prototype)), m_body(std::move(body)) {}
 
-    auto generate_code() -> llvm::Value* override;
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
+
+    [[nodiscard]] auto get_prototype() const -> const PrototypeAst& { return *m_prototype; }
 };
 
 // Imports
@@ -112,7 +289,7 @@ private:
 
 public:
     ImportAst(std::string import): m_import(std::move(import)) {}
-    auto generate_code() -> llvm::Value* override;
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
 };
 
 
@@ -122,17 +299,20 @@ private:
     std::vector<std::unique_ptr<PrototypeAst>> m_prototypes;
     std::vector<std::unique_ptr<ImportAst>> m_imports;
     std::vector<std::unique_ptr<VariableExprAst>> m_global_variables;
+    std::vector<std::unique_ptr<FunctionAst>> m_functions;
 
 public:
     ModuleAst(std::vector<std::unique_ptr<PrototypeAst>> prototypes,
               std::vector<std::unique_ptr<ImportAst>> imports,
-              std::vector<std::unique_ptr<VariableExprAst>> global_variables) 
+              std::vector<std::unique_ptr<VariableExprAst>> global_variables,
+              std::vector<std::unique_ptr<FunctionAst>> functions)
 
     : m_prototypes(std::move(prototypes)),
       m_imports(std::move(imports)),
-      m_global_variables(std::move(global_variables)) {}
+      m_global_variables(std::move(global_variables)),
+      m_functions(std::move(functions)) {}
 
-    auto generate_code() -> llvm::Value* override;
+    auto generate_code(CodegenContext &context) -> llvm::Value* override;
 };
 
 
@@ -143,23 +323,65 @@ private:
     std::unique_ptr<Lexer> m_lexer;
     std::unique_ptr<ModuleAst> m_module_ast;
     Token m_current_token;
+    unsigned m_depth = 0;
+
+    // Top level declarations seen so far, a copy of every function's prototype is kept
+    // so functions can still be called after their body has been released
+    std::vector<std::unique_ptr<PrototypeAst>> m_prototypes;
+    std::vector<std::unique_ptr<ImportAst>> m_imports;
+    std::unordered_map<std::string, const PrototypeAst*> m_declarations;
+    std::unordered_set<std::string> m_defined_functions;
 
     static auto get_token_priority(const TokenType &type) -> uint8_t;
+    static auto is_type_keyword(TokenType type) -> bool;
 
     inline void advance();
+    void expect(TokenType type);
+    auto parse_type() -> QuarkType;
+    auto parse_return_type() -> QuarkType;
     auto parse_number() -> std::unique_ptr<ExprAst>;
     auto parse_paren_expr() -> std::unique_ptr<ExprAst>;
     auto parse_identifier() -> std::unique_ptr<ExprAst>;
     auto parse_primary() -> std::unique_ptr<ExprAst>;
     auto parse_binop_rhs(int expr_prec, std::unique_ptr<ExprAst> LHS) -> std::unique_ptr<ExprAst>;
     auto parse_expression() -> std::unique_ptr<ExprAst>;
+    auto parse_var_decl() -> std::unique_ptr<ExprAst>;
+    auto parse_block() -> std::unique_ptr<ExprAst>;
+    auto parse_if() -> std::unique_ptr<ExprAst>;
+    auto parse_for() -> std::unique_ptr<ExprAst>;
+    auto parse_while() -> std::unique_ptr<ExprAst>;
+    auto parse_return() -> std::unique_ptr<ExprAst>;
+    auto parse_statement() -> std::unique_ptr<ExprAst>;
     auto parse_prototype() -> std::unique_ptr<PrototypeAst>;
     auto parse_function() -> std::unique_ptr<FunctionAst>;
     auto parse_import() -> std::unique_ptr<ImportAst>;
+    void skip_block();
 
-    void parse_top_level_exp();
+    // Keeps a top level prototype. A function may be declared any number of times, but
+    // always with the same signature, and defined once
+    void declare(std::unique_ptr<PrototypeAst> prototype, bool is_definition);
+
+    // Parses one top level declaration, returns the function if it was a definition
+    auto parse_top_level_exp() -> std::unique_ptr<FunctionAst>;
 
 public:
     QuarkParser(std::unique_ptr<Lexer> lexer): m_lexer(std::move(lexer)), m_module_ast(nullptr) {}
+
+    // Parses the whole file into the module AST
     void parse_code();
+    [[nodiscard]] auto get_module_ast() const -> ModuleAst* { return m_module_ast.get(); }
+
+    // Parses up to and including the next function definition, returns null at the end
+    // of the file. Only the prototypes are kept for the functions already returned
+    auto parse_next_function() -> std::unique_ptr<FunctionAst>;
+
+    // Collects the prototypes of every top level declaration while skipping the function
+    // bodies, so a streaming compilation knows every function before it generates code
+    void parse_declarations();
+    [[nodiscard]] auto get_prototypes() const -> const std::vector<std::unique_ptr<PrototypeAst>>& {
+        return m_prototypes;
+    }
+    [[nodiscard]] auto get_defined_functions() const -> const std::unordered_set<std::string>& {
+        return m_defined_functions;
+    }
 };
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <fstream>
 #include <mutex>
@@ -10,7 +12,8 @@ enum class Level : std::uint8_t {
     DEBUG,
     INFO,
     WARNING,
-    ERROR
+    ERROR,
+    OFF         // Only used as a threshold, drops every message
 };
 
 class QuarkLogger {
@@ -18,6 +21,7 @@ private:
     static std::unique_ptr<QuarkLogger> m_instance;
     static std::mutex m_mutex;
     std::ofstream log_file;
+    std::atomic<Level> m_level = Level::DEBUG;
 
     static auto get_time() -> std::string;
     static auto level_to_string(Level level) -> std::string;
@@ -37,4 +41,18 @@ public:
     void debug(const std::string &msg);
     void warn(const std::string &msg);
     void error(const std::string &msg);
+
+    // Drops messages below the level, a long running compiler only keeps warnings and errors
+    // and the fuzzers turn logging off. Callers check is_enabled before formatting messages
+    // that are logged often, so dropped messages cost neither the formatting nor the lock
+    void set_level(Level level);
+    [[nodiscard]] auto is_enabled(Level level) const -> bool {
+        return level >= m_level.load(std::memory_order_relaxed);
+    }
 };
+
+// Parses sizes like 512M, the suffixes K, M and G are powers of 1024
+auto parse_size(const std::string &size) -> std::size_t;
+
+// Parses a count such as a number of threads, the whole string has to be a decimal number
+auto parse_count(const std::string &count) -> unsigned;
@@ -0,0 +1,394 @@
+#include "backend.hpp"
+#include "linker.hpp"
+#include "utils.hpp"
+
+#include <llvm/Analysis/CGSCCPassManager.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Analysis/LoopAnalysisManager.h>
+#include <llvm/IR/DiagnosticHandler.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/DiagnosticPrinter.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/ProfileData/InstrProfReader.h>
+#include <llvm/Support/CodeGen.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/SmallVectorMemoryBuffer.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/Optional.h>
+#include <llvm/Target/TargetOptions.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Partitions depend on the module alone and not on the number of threads, so the same source
+// gives the same object on every machine
+constexpr unsigned FUNCTIONS_PER_PARTITION = 256;
+
+// Keeps the first error instead of letting LLVM print it and exit the process, and prints the
+// loop vectorizer's remarks when they are asked for. Other diagnostics keep their default handling
+class BackendDiagnosticHandler : public llvm::DiagnosticHandler {
+private:
+    bool m_vectorize_report;
+    std::string m_error;
+
+public:
+    explicit BackendDiagnosticHandler(bool vectorize_report) : m_vectorize_report(vectorize_report) {}
+
+    auto handleDiagnostics(const llvm::DiagnosticInfo &info) -> bool override {
+        if (info.getSeverity() == llvm::DS_Error) {
+            if (m_error.empty()) {
+                llvm::raw_string_ostream stream(m_error);
+                llvm::DiagnosticPrinterRawOStream printer(stream);
+                info.print(printer);
+            }
+            return true;
+        }
+
+        const auto *remark = llvm::dyn_cast<llvm::DiagnosticInfoOptimizationBase>(&info);
+        if (remark == nullptr || !isEnabled(remark->getPassName())) {
+            return false;
+        }
+
+        static std::mutex output_mutex;
+        const std::lock_guard<std::mutex> lock(output_mutex);
+        llvm::errs() << "remark: " << remark->getFunction().getName() << ": " << remark->getMsg() << '\n';
+        return true;
+    }
+
+    [[nodiscard]] auto error() const -> const std::string& {
+        return m_error;
+    }
+
+    [[nodiscard]] auto isEnabled(llvm::StringRef pass_name) const -> bool {
+        return m_vectorize_report && pass_name == "loop-vectorize";
+    }
+    [[nodiscard]] auto isAnyRemarkEnabled() const -> bool override {
+        return m_vectorize_report;
+    }
+    [[nodiscard]] auto isAnalysisRemarkEnabled(llvm::StringRef pass_name) const -> bool override {
+        return isEnabled(pass_name);
+    }
+    [[nodiscard]] auto isMissedOptRemarkEnabled(llvm::StringRef pass_name) const -> bool override {
+        return isEnabled(pass_name);
+    }
+    [[nodiscard]] auto isPassedOptRemarkEnabled(llvm::StringRef pass_name) const -> bool override {
+        return isEnabled(pass_name);
+    }
+};
+
+// Installs a BackendDiagnosticHandler on a context for as long as it lives
+class DiagnosticScope {
+private:
+    llvm::LLVMContext &m_context;
+    std::unique_ptr<llvm::DiagnosticHandler> m_previous_handler;
+    const BackendDiagnosticHandler *m_handler = nullptr;
+
+public:
+    DiagnosticScope(llvm::LLVMContext &context, bool vectorize_report)
+    : m_context(context), m_previous_handler(context.getDiagnosticHandler()) {
+        auto handler = std::make_unique<BackendDiagnosticHandler>(vectorize_report);
+        m_handler = handler.get();
+        m_context.setDiagnosticHandler(std::move(handler));
+    }
+
+    DiagnosticScope(const DiagnosticScope&) = delete;
+    auto operator=(const DiagnosticScope&) -> DiagnosticScope& = delete;
+    DiagnosticScope(DiagnosticScope&&) = delete;
+    auto operator=(DiagnosticScope&&) -> DiagnosticScope& = delete;
+
+    ~DiagnosticScope() {
+        m_context.setDiagnosticHandler(std::move(m_previous_handler));
+    }
+
+    // Throws the first error reported since the scope was entered
+    void check() const {
+        if (!m_handler->error().empty()) {
+            throw std::runtime_error(m_handler->error());
+        }
+    }
+};
+
+// Throws unless the file is an indexed profile written by an instrumented Quark build
+void check_profile(const std::string &path) {
+    if (!llvm::sys::fs::exists(path)) {
+        throw std::runtime_error("Profile file not found: " + path);
+    }
+
+    llvm::Expected<std::unique_ptr<llvm::IndexedInstrProfReader>> reader = llvm::IndexedInstrProfReader::create(path);
+    if (!reader) {
+        throw std::runtime_error("Invalid profile file " + path + ": " + llvm::toString(reader.takeError()));
+    }
+    if (!(*reader)->isIRLevelProfile()) {
+        throw std::runtime_error("Profile file " + path + " was not generated with --pgo-generate");
+    }
+}
+
+} // namespace
+
+QuarkBackend::QuarkBackend(BackendOptions options)
+: m_options(std::move(options)), m_thread_pool(llvm::hardware_concurrency(m_options.threads)) {
+    initialize_targets();
+    m_target_machine = create_target_machine();
+    if (!m_target_machine->getMCSubtargetInfo()->isCPUStringValid(m_target_machine->getTargetCPU())) {
+        throw std::runtime_error("Unknown CPU: " + m_options.cpu);
+    }
+
+    if (m_options.pgo_mode == PgoMode::USE) {
+        check_profile(m_options.pgo_profile_file);
+    }
+}
+
+auto QuarkBackend::create_target_machine() const -> std::unique_ptr<llvm::TargetMachine> {
+    const std::string triple = llvm::sys::getDefaultTargetTriple();
+    std::string error;
+    const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple, error);
+    if (target == nullptr) {
+        throw std::runtime_error("Failed to look up target " + triple + ": " + error);
+    }
+
+    // A named CPU only gets the features of its model, so the object also runs on other
+    // machines with that CPU or a newer one
+    std::string cpu = m_options.cpu;
+    llvm::SubtargetFeatures features;
+    if (cpu == "native") {
+        cpu = llvm::sys::getHostCPUName().str();
+        llvm::StringMap<bool> host_features;
+        if (llvm::sys::getHostCPUFeatures(host_features)) {
+            for (const auto &feature : host_features) {
+                features.AddFeature(feature.first(), feature.second);
+            }
+        }
+    }
+
+    std::unique_ptr<llvm::TargetMachine> target_machine(target->createTargetMachine(
+        triple, cpu, features.getString(),
+        llvm::TargetOptions(), llvm::Reloc::PIC_));
+    if (target_machine == nullptr) {
+        throw std::runtime_error("Failed to create target machine for " + triple);
+    }
+    return target_machine;
+}
+
+auto QuarkBackend::acquire_target_machine() const -> std::unique_ptr<llvm::TargetMachine> {
+    {
+        const std::lock_guard<std::mutex> lock(m_target_machines_mutex);
+        if (!m_target_machines.empty()) {
+            std::unique_ptr<llvm::TargetMachine> target_machine = std::move(m_target_machines.back());
+            m_target_machines.pop_back();
+            return target_machine;
+        }
+    }
+    return create_target_machine();
+}
+
+void QuarkBackend::release_target_machine(std::unique_ptr<llvm::TargetMachine> target_machine) const {
+    const std::lock_guard<std::mutex> lock(m_target_machines_mutex);
+    m_target_machines.push_back(std::move(target_machine));
+}
+
+void QuarkBackend::initialize_targets() {
+    static std::once_flag initialized;
+    std::call_once(initialized, [] {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+
+        // Float reductions such as a dot product are vectorized with in-order reductions,
+        // the additions keep their source order and results stay those of the scalar loop
+        llvm::cl::Option *ordered_reductions = llvm::cl::getRegisteredOptions().lookup("force-ordered-reductions");
+        if (ordered_reductions != nullptr) {
+            ordered_reductions->addOccurrence(0, "force-ordered-reductions", "true");
+        }
+    });
+}
+
+auto QuarkBackend::create_pgo_options() const -> llvm::Optional<llvm::PGOOptions> {
+    switch (m_options.pgo_mode) {
+        case PgoMode::GENERATE:
+            // The profile file becomes the default output path of the profile runtime
+            return llvm::PGOOptions(m_options.pgo_profile_file, "", "", llvm::PGOOptions::IRInstr);
+        case PgoMode::USE:
+            return llvm::PGOOptions(m_options.pgo_profile_file, "", "", llvm::PGOOptions::IRUse);
+        case PgoMode::NONE:
+        default:
+            return llvm::None;
+    }
+}
+
+void QuarkBackend::prepare_module(llvm::Module &module) const {
+    module.setTargetTriple(m_target_machine->getTargetTriple().str());
+    module.setDataLayout(m_target_machine->createDataLayout());
+}
+
+void QuarkBackend::optimize(llvm::Module &module) const {
+    std::unique_ptr<llvm::TargetMachine> target_machine = acquire_target_machine();
+    optimize(module, *target_machine);
+    release_target_machine(std::move(target_machine));
+}
+
+void QuarkBackend::optimize(llvm::Module &module, llvm::TargetMachine &target_machine) const {
+    llvm::LoopAnalysisManager loop_am;
+    llvm::FunctionAnalysisManager function_am;
+    llvm::CGSCCAnalysisManager cgscc_am;
+    llvm::ModuleAnalysisManager module_am;
+
+    llvm::PipelineTuningOptions tuning_options;
+    tuning_options.LoopVectorization = true;
+    tuning_options.SLPVectorization = true;
+
+    llvm::PassBuilder pass_builder(&target_machine, tuning_options, create_pgo_options());
+    pass_builder.registerModuleAnalyses(module_am);
+    pass_builder.registerCGSCCAnalyses(cgscc_am);
+    pass_builder.registerFunctionAnalyses(function_am);
+    pass_builder.registerLoopAnalyses(loop_am);
+    pass_builder.crossRegisterProxies(loop_am, function_am, cgscc_am, module_am);
+
+    const DiagnosticScope diagnostics(module.getContext(), m_options.vectorize_report);
+    llvm::ModulePassManager module_pm = pass_builder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2);
+    module_pm.run(module, module_am);
+    diagnostics.check();
+}
+
+void QuarkBackend::emit_object(llvm::Module &module, llvm::TargetMachine &target_machine,
+                               llvm::raw_pwrite_stream &dest) {
+    llvm::legacy::PassManager codegen_pm;
+    if (target_machine.addPassesToEmitFile(codegen_pm, dest, nullptr, llvm::CGFT_ObjectFile)) {
+        throw std::runtime_error("Target machine cannot emit an object file");
+    }
+    const DiagnosticScope diagnostics(module.getContext(), false);
+    codegen_pm.run(module);
+    diagnostics.check();
+}
+
+auto QuarkBackend::emit_to_buffer(llvm::Module &module, llvm::TargetMachine &target_machine)
+    -> std::unique_ptr<llvm::MemoryBuffer> {
+    llvm::SmallVector<char, 0> object;
+    llvm::raw_svector_ostream dest(object);
+    emit_object(module, target_machine, dest);
+    return std::make_unique<llvm::SmallVectorMemoryBuffer>(std::move(object), false);
+}
+
+auto QuarkBackend::partition_count(const llvm::Module &module) -> unsigned {
+    unsigned defined_functions = 0;
+    for (const llvm::Function &function : module) {
+        if (!function.isDeclaration()) {
+            ++defined_functions;
+        }
+    }
+    return std::max(1U, defined_functions / FUNCTIONS_PER_PARTITION);
+}
+
+auto QuarkBackend::compile_partition(const llvm::SmallVector<char, 0> &bitcode, unsigned index) const
+    -> std::unique_ptr<llvm::MemoryBuffer> {
+    // Every partition is reloaded into its own context and gets its own target machine,
+    // neither is safe to share between threads
+    llvm::LLVMContext context;
+    const llvm::MemoryBufferRef buffer(llvm::StringRef(bitcode.data(), bitcode.size()),
+                                       "partition" + std::to_string(index));
+    llvm::Expected<std::unique_ptr<llvm::Module>> module = llvm::parseBitcodeFile(buffer, context);
+    if (!module) {
+        throw std::runtime_error("Failed to load partition: " + llvm::toString(module.takeError()));
+    }
+
+    std::unique_ptr<llvm::TargetMachine> target_machine = acquire_target_machine();
+    optimize(**module, *target_machine);
+    std::unique_ptr<llvm::MemoryBuffer> object = emit_to_buffer(**module, *target_machine);
+    release_target_machine(std::move(target_machine));
+    return object;
+}
+
+auto QuarkBackend::compile_to_buffers(llvm::Module &module) const -> std::vector<std::unique_ptr<llvm::MemoryBuffer>> {
+    auto *logger = QuarkLogger::get_instance();
+
+    if (m_options.pgo_mode == PgoMode::GENERATE) {
+        logger->info("Instrumenting module for profile generation, profile: " + m_options.pgo_profile_file);
+    }
+    else if (m_options.pgo_mode == PgoMode::USE) {
+        logger->info("Optimizing module with profile: " + m_options.pgo_profile_file);
+    }
+
+    std::vector<std::unique_ptr<llvm::MemoryBuffer>> objects;
+    const unsigned partitions = partition_count(module);
+    if (partitions <= 1) {
+        objects.push_back(compile_to_buffer(module));
+        return objects;
+    }
+
+    std::vector<llvm::SmallVector<char, 0>> bitcode;
+    llvm::SplitModule(module, partitions, [&bitcode](std::unique_ptr<llvm::Module> part) {
+        llvm::raw_svector_ostream stream(bitcode.emplace_back());
+        llvm::WriteBitcodeToFile(*part, stream);
+    });
+    logger->info("Compiling module in " + std::to_string(bitcode.size()) + " partitions");
+
+    // Only this compilation's tasks are waited for, the pool may be shared with others
+    objects.resize(bitcode.size());
+    std::vector<std::string> errors(bitcode.size());
+    std::vector<std::shared_future<void>> tasks;
+    for (unsigned i = 0; i < bitcode.size(); ++i) {
+        tasks.push_back(m_thread_pool.async([this, &bitcode, &objects, &errors, i] {
+            try {
+                objects[i] = compile_partition(bitcode[i], i);
+            }
+            catch (const std::exception &error) {
+                errors[i] = error.what();
+            }
+        }));
+    }
+    for (const auto &task : tasks) {
+        task.wait();
+    }
+
+    for (const std::string &error : errors) {
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+    }
+    return objects;
+}
+
+auto QuarkBackend::compile_to_buffer(llvm::Module &module) const -> std::unique_ptr<llvm::MemoryBuffer> {
+    std::unique_ptr<llvm::TargetMachine> target_machine = acquire_target_machine();
+    optimize(module, *target_machine);
+    std::unique_ptr<llvm::MemoryBuffer> object = emit_to_buffer(module, *target_machine);
+    release_target_machine(std::move(target_machine));
+    return object;
+}
+
+auto QuarkBackend::merge_objects(std::vector<std::unique_ptr<llvm::MemoryBuffer>> objects)
+    -> std::unique_ptr<llvm::MemoryBuffer> {
+    if (objects.size() == 1) {
+        return std::move(objects.front());
+    }
+
+    ObjectLinker linker;
+    for (const auto &object : objects) {
+        linker.add(*object);
+    }
+    objects.clear();
+    return linker.link_to_buffer();
+}
@@ -0,0 +1,676 @@
+#include "codegen.hpp"
+#include "parser.hpp"
+#include "constants.hpp"
+#include "lexer.hpp"
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/CallingConv.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+auto CodegenContext::body_name(const std::string &function_name) -> std::string {
+    return function_name + ".body";
+}
+
+auto CodegenContext::get_type(QuarkType type) -> llvm::Type* {
+    switch (type) {
+        case QuarkType::VOID:
+            throw std::runtime_error("void is not a type of values");
+        case QuarkType::INT: return builder.getInt64Ty();
+        case QuarkType::FLOAT: return builder.getDoubleTy();
+        case QuarkType::BOOL: return builder.getInt1Ty();
+        case QuarkType::INT_ARRAY:
+        case QuarkType::FLOAT_ARRAY:
+            return get_type(element_type(type))->getPointerTo();
+        default: [[unlikely]]
+            throw std::runtime_error("Unknown type");
+    }
+}
+
+auto CodegenContext::get_return_type(QuarkType type) -> llvm::Type* {
+    return type == QuarkType::VOID ? builder.getVoidTy() : get_type(type);
+}
+
+auto CodegenContext::is_array(QuarkType type) -> bool {
+    return type == QuarkType::INT_ARRAY || type == QuarkType::FLOAT_ARRAY;
+}
+
+auto CodegenContext::element_type(QuarkType array_type) -> QuarkType {
+    switch (array_type) {
+        case QuarkType::INT_ARRAY: return QuarkType::INT;
+        case QuarkType::FLOAT_ARRAY: return QuarkType::FLOAT;
+        default:
+            throw std::runtime_error("Type is not an array");
+    }
+}
+
+auto CodegenContext::create_entry_block_alloca(llvm::Function *function, const std::string &name,
+                                               llvm::Type *type) -> llvm::AllocaInst* {
+    llvm::IRBuilder<> entry_builder(&function->getEntryBlock(), function->getEntryBlock().begin());
+    return entry_builder.CreateAlloca(type, nullptr, name);
+}
+
+auto CodegenContext::convert(llvm::Value *value, llvm::Type *type) -> llvm::Value* {
+    llvm::Type *from = value->getType();
+    if (from == type) {
+        return value;
+    }
+    if (type->isIntegerTy(1)) {
+        return to_condition(value);
+    }
+    if (from->isIntegerTy() && type->isIntegerTy()) {
+        return from->isIntegerTy(1) ? builder.CreateZExt(value, type) : builder.CreateSExtOrTrunc(value, type);
+    }
+    if (from->isIntegerTy() && type->isFloatingPointTy()) {
+        return from->isIntegerTy(1) ? builder.CreateUIToFP(value, type) : builder.CreateSIToFP(value, type);
+    }
+    if (from->isFloatingPointTy() && type->isIntegerTy()) {
+        return builder.CreateFPToSI(value, type);
+    }
+    if (from->isFloatingPointTy() && type->isFloatingPointTy()) {
+        return builder.CreateFPCast(value, type);
+    }
+    throw std::runtime_error("Invalid type conversion");
+}
+
+auto CodegenContext::to_condition(llvm::Value *value) -> llvm::Value* {
+    llvm::Type *type = value->getType();
+    if (type->isIntegerTy(1)) {
+        return value;
+    }
+    if (type->isIntegerTy()) {
+        return builder.CreateICmpNE(value, llvm::ConstantInt::get(type, 0), "cond");
+    }
+    if (type->isFloatingPointTy()) {
+        // NaN is true, as in C
+        return builder.CreateFCmpUNE(value, llvm::ConstantFP::get(type, 0.0), "cond");
+    }
+    throw std::runtime_error("Value cannot be used as a condition");
+}
+
+auto CodegenContext::create_loop_metadata() -> llvm::MDNode* {
+    llvm::LLVMContext &llvm_context = module.getContext();
+
+    // Like loops in C11 whose condition is not a constant, a loop without side effects has
+    // to terminate, so it may be removed or rotated without proving that it does. Nothing
+    // forces the vectorizer, it keeps its own cost model
+    auto placeholder = llvm::MDNode::getTemporary(llvm_context, llvm::None);
+    const std::array<llvm::Metadata*, 2> operands = {
+        placeholder.get(),
+        llvm::MDNode::get(llvm_context, llvm::MDString::get(llvm_context, "llvm.loop.mustprogress")),
+    };
+
+    llvm::MDNode *loop_id = llvm::MDNode::getDistinct(llvm_context, operands);
+    loop_id->replaceOperandWith(0, loop_id);
+    return loop_id;
+}
+
+auto NumberExprAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    return llvm::ConstantFP::get(context.builder.getDoubleTy(), m_val);
+}
+
+auto IntegerExprAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    return llvm::ConstantInt::getSigned(context.builder.getInt64Ty(), m_val);
+}
+
+auto BoolExprAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    return context.builder.getInt1(m_val);
+}
+
+auto VariableExprAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    auto variable = context.named_values.find(m_name);
+    if (variable != context.named_values.end()) {
+        return context.builder.CreateLoad(variable->second->getAllocatedType(), variable->second, m_name);
+    }
+    if (context.arrays.contains(m_name)) {
+        throw std::runtime_error("Array used as a value: " + m_name);
+    }
+    if (llvm::GlobalVariable *global = context.module.getNamedGlobal(m_name); global != nullptr) {
+        return context.builder.CreateLoad(global->getValueType(), global, m_name);
+    }
+    throw std::runtime_error("Unknown variable name: " + m_name);
+}
+
+auto VarDeclExprAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    if (CodegenContext::is_array(m_type)) {
+        throw std::runtime_error("Arrays can only be declared as function arguments: " + m_name);
+    }
+
+    llvm::Function *function = context.builder.GetInsertBlock()->getParent();
+    llvm::Type *type = context.get_type(m_type);
+    llvm::Value *init = m_init != nullptr
+        ? context.convert(m_init->generate_code(context), type)
+        : llvm::Constant::getNullValue(type);
+
+    llvm::AllocaInst *alloca = context.create_entry_block_alloca(function, m_name, type);
+    context.builder.CreateStore(init, alloca);
+    context.named_values[m_name] = alloca;
+    return nullptr;
+}
+
+auto ArrayIndexExprAst::element_pointer(CodegenContext &context) -> std::pair<llvm::Value*, llvm::Type*> {
+    auto array = context.arrays.find(m_name);
+    if (array == context.arrays.end()) {
+        throw std::runtime_error("Unknown array name: " + m_name);
+    }
+
+    llvm::Type *element_type = context.get_type(array->second.element_type);
+    llvm::Value *index = context.convert(m_index->generate_code(context), context.builder.getInt64Ty());
+    llvm::Value *pointer = context.builder.CreateInBoundsGEP(element_type, array->second.data, index, m_name + ".addr");
+    return {pointer, element_type};
+}
+
+auto ArrayIndexExprAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    auto [pointer, element_type] = element_pointer(context);
+    const llvm::Align align = context.module.getDataLayout().getABITypeAlign(element_type);
+    return context.builder.CreateAlignedLoad(element_type, pointer, align, m_name + ".elem");
+}
+
+auto ArrayIndexExprAst::generate_store(CodegenContext &context, llvm::Value *value) -> llvm::Value* {
+    auto [pointer, element_type] = element_pointer(context);
+    const llvm::Align align = context.module.getDataLayout().getABITypeAlign(element_type);
+    context.builder.CreateAlignedStore(context.convert(value, element_type), pointer, align);
+    return value;
+}
+
+auto ArrayLengthExprAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    auto array = context.arrays.find(m_name);
+    if (array == context.arrays.end()) {
+        throw std::runtime_error("Unknown array name: " + m_name);
+    }
+    return array->second.length;
+}
+
+auto BinaryExprAst::generate_logical(CodegenContext &context) -> llvm::Value* {
+    auto &builder = context.builder;
+    auto &llvm_context = context.module.getContext();
+    const bool is_and = m_operator == TokenType::AND;
+
+    // The right hand side is only evaluated when it decides the result
+    llvm::Value *lhs = context.to_condition(m_LHS->generate_code(context));
+    llvm::BasicBlock *lhs_block = builder.GetInsertBlock();
+    llvm::Function *function = lhs_block->getParent();
+    llvm::BasicBlock *rhs_block = llvm::BasicBlock::Create(llvm_context, "logic.rhs", function);
+    llvm::BasicBlock *end_block = llvm::BasicBlock::Create(llvm_context, "logic.end", function);
+    builder.CreateCondBr(lhs, is_and ? rhs_block : end_block, is_and ? end_block : rhs_block);
+
+    builder.SetInsertPoint(rhs_block);
+    llvm::Value *rhs = context.to_condition(m_RHS->generate_code(context));
+    rhs_block = builder.GetInsertBlock();
+    builder.CreateBr(end_block);
+
+    builder.SetInsertPoint(end_block);
+    llvm::PHINode *result = builder.CreatePHI(builder.getInt1Ty(), 2, "logictmp");
+    result->addIncoming(builder.getInt1(!is_and), lhs_block);
+    result->addIncoming(rhs, rhs_block);
+    return result;
+}
+
+auto BinaryExprAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    auto &builder = context.builder;
+
+    if (m_operator == TokenType::EQUALS) {
+        llvm::Value *value = m_RHS->generate_code(context);
+        if (auto *variable = dynamic_cast<VariableExprAst*>(m_LHS.get()); variable != nullptr) {
+            auto alloca = context.named_values.find(variable->get_name());
+            if (alloca == context.named_values.end()) {
+                throw std::runtime_error("Unknown variable name: " + variable->get_name());
+            }
+            builder.CreateStore(context.convert(value, alloca->second->getAllocatedType()), alloca->second);
+            return value;
+        }
+        if (auto *element = dynamic_cast<ArrayIndexExprAst*>(m_LHS.get()); element != nullptr) {
+            return element->generate_store(context, value);
+        }
+        throw std::runtime_error("Invalid assignment target");
+    }
+    if (m_operator == TokenType::AND || m_operator == TokenType::OR) {
+        return generate_logical(context);
+    }
+
+    llvm::Value *lhs = m_LHS->generate_code(context);
+    llvm::Value *rhs = m_RHS->generate_code(context);
+
+    const bool is_float = lhs->getType()->isFloatingPointTy() || rhs->getType()->isFloatingPointTy()
+                          || m_operator == TokenType::EXPONENTIATION;
+    llvm::Type *type = is_float ? builder.getDoubleTy() : builder.getInt64Ty();
+    lhs = context.convert(lhs, type);
+    rhs = context.convert(rhs, type);
+
+    // Integer arithmetic is nsw so loop induction variables stay analyzable. Float
+    // comparisons are ordered like in C, any comparison with NaN except != is false
+    switch (m_operator) {
+        case TokenType::PLUS: return is_float ? builder.CreateFAdd(lhs, rhs, "addtmp") : builder.CreateNSWAdd(lhs, rhs, "addtmp");
+        case TokenType::MINUS: return is_float ? builder.CreateFSub(lhs, rhs, "subtmp") : builder.CreateNSWSub(lhs, rhs, "subtmp");
+        case TokenType::ASTERISK: return is_float ? builder.CreateFMul(lhs, rhs, "multmp") : builder.CreateNSWMul(lhs, rhs, "multmp");
+        case TokenType::SLASH: return is_float ? builder.CreateFDiv(lhs, rhs, "divtmp") : builder.CreateSDiv(lhs, rhs, "divtmp");
+        case TokenType::EXPONENTIATION: return builder.CreateBinaryIntrinsic(llvm::Intrinsic::pow, lhs, rhs, nullptr, "powtmp");
+        case TokenType::LESS: return is_float ? builder.CreateFCmpOLT(lhs, rhs, "cmptmp") : builder.CreateICmpSLT(lhs, rhs, "cmptmp");
+        case TokenType::GREATER: return is_float ? builder.CreateFCmpOGT(lhs, rhs, "cmptmp") : builder.CreateICmpSGT(lhs, rhs, "cmptmp");
+        case TokenType::LESS_EQUALS: return is_float ? builder.CreateFCmpOLE(lhs, rhs, "cmptmp") : builder.CreateICmpSLE(lhs, rhs, "cmptmp");
+        case TokenType::GREATER_EQUALS: return is_float ? builder.CreateFCmpOGE(lhs, rhs, "cmptmp") : builder.CreateICmpSGE(lhs, rhs, "cmptmp");
+        case TokenType::EQUALS_EQUALS: return is_float ? builder.CreateFCmpOEQ(lhs, rhs, "cmptmp") : builder.CreateICmpEQ(lhs, rhs, "cmptmp");
+        case TokenType::NOT_EQUALS: return is_float ? builder.CreateFCmpUNE(lhs, rhs, "cmptmp") : builder.CreateICmpNE(lhs, rhs, "cmptmp");
+        default:
+            throw std::runtime_error("Invalid binary operator: " + token_to_string(m_operator));
+    }
+}
+
+auto BlockExprAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    auto outer_scope = context.named_values;
+
+    llvm::Value *last = nullptr;
+    for (auto &expression : m_body) {
+        last = expression->generate_code(context);
+    }
+
+    context.named_values = std::move(outer_scope);
+    return last;
+}
+
+auto IfExprAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    auto &builder = context.builder;
+    auto &llvm_context = context.module.getContext();
+
+    llvm::Function *function = builder.GetInsertBlock()->getParent();
+    llvm::BasicBlock *then_block = llvm::BasicBlock::Create(llvm_context, "if.then", function);
+    llvm::BasicBlock *else_block = m_else != nullptr ? llvm::BasicBlock::Create(llvm_context, "if.else", function) : nullptr;
+    llvm::BasicBlock *end_block = llvm::BasicBlock::Create(llvm_context, "if.end", function);
+
+    builder.CreateCondBr(context.to_condition(m_cond->generate_code(context)), then_block,
+                         else_block != nullptr ? else_block : end_block);
+
+    builder.SetInsertPoint(then_block);
+    m_then->generate_code(context);
+    if (builder.GetInsertBlock()->getTerminator() == nullptr) {
+        builder.CreateBr(end_block);
+    }
+
+    if (else_block != nullptr) {
+        builder.SetInsertPoint(else_block);
+        m_else->generate_code(context);
+        if (builder.GetInsertBlock()->getTerminator() == nullptr) {
+            builder.CreateBr(end_block);
+        }
+    }
+
+    builder.SetInsertPoint(end_block);
+    return nullptr;
+}
+
+auto ForExprAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    auto &builder = context.builder;
+    auto &llvm_context = context.module.getContext();
+    auto outer_scope = context.named_values;
+
+    if (m_init != nullptr) {
+        m_init->generate_code(context);
+    }
+
+    llvm::Function *function = builder.GetInsertBlock()->getParent();
+    llvm::BasicBlock *cond_block = llvm::BasicBlock::Create(llvm_context, "for.cond", function);
+    llvm::BasicBlock *body_block = llvm::BasicBlock::Create(llvm_context, "for.body", function);
+    llvm::BasicBlock *step_block = llvm::BasicBlock::Create(llvm_context, "for.step", function);
+    llvm::BasicBlock *end_block = llvm::BasicBlock::Create(llvm_context, "for.end", function);
+
+    builder.CreateBr(cond_block);
+    builder.SetInsertPoint(cond_block);
+    bool must_progress = false;
+    if (m_cond != nullptr) {
+        llvm::Value *condition = context.to_condition(m_cond->generate_code(context));
+        must_progress = !llvm::isa<llvm::Constant>(condition);
+        builder.CreateCondBr(condition, body_block, end_block);
+    }
+    else {
+        builder.CreateBr(body_block);
+    }
+
+    builder.SetInsertPoint(body_block);
+    m_body->generate_code(context);
+    if (builder.GetInsertBlock()->getTerminator() == nullptr) {
+        builder.CreateBr(step_block);
+    }
+
+    builder.SetInsertPoint(step_block);
+    if (m_step != nullptr) {
+        m_step->generate_code(context);
+    }
+    llvm::BranchInst *latch = builder.CreateBr(cond_block);
+    if (must_progress) {
+        latch->setMetadata(llvm::LLVMContext::MD_loop, context.create_loop_metadata());
+    }
+
+    builder.SetInsertPoint(end_block);
+    context.named_values = std::move(outer_scope);
+    return nullptr;
+}
+
+auto WhileExprAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    auto &builder = context.builder;
+    auto &llvm_context = context.module.getContext();
+
+    llvm::Function *function = builder.GetInsertBlock()->getParent();
+    llvm::BasicBlock *cond_block = llvm::BasicBlock::Create(llvm_context, "while.cond", function);
+    llvm::BasicBlock *body_block = llvm::BasicBlock::Create(llvm_context, "while.body", function);
+    llvm::BasicBlock *end_block = llvm::BasicBlock::Create(llvm_context, "while.end", function);
+
+    builder.CreateBr(cond_block);
+    builder.SetInsertPoint(cond_block);
+    llvm::Value *condition = context.to_condition(m_cond->generate_code(context));
+    builder.CreateCondBr(condition, body_block, end_block);
+
+    builder.SetInsertPoint(body_block);
+    m_body->generate_code(context);
+    if (builder.GetInsertBlock()->getTerminator() == nullptr) {
+        llvm::BranchInst *latch = builder.CreateBr(cond_block);
+        if (!llvm::isa<llvm::Constant>(condition)) {
+            latch->setMetadata(llvm::LLVMContext::MD_loop, context.create_loop_metadata());
+        }
+    }
+
+    builder.SetInsertPoint(end_block);
+    return nullptr;
+}
+
+auto ReturnExprAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    auto &builder = context.builder;
+    llvm::Function *function = builder.GetInsertBlock()->getParent();
+
+    auto *call = dynamic_cast<CallExprAst*>(m_value.get());
+    if (call != nullptr && context.tail_calls) {
+        return call->generate_tail_call(context);
+    }
+
+    llvm::Value *value = m_value != nullptr ? m_value->generate_code(context) : nullptr;
+    if (function->getReturnType()->isVoidTy()) {
+        builder.CreateRetVoid();
+    }
+    else if (value != nullptr) {
+        builder.CreateRet(context.convert(value, function->getReturnType()));
+    }
+    else {
+        throw std::runtime_error("Missing return value in function: " + function->getName().str());
+    }
+
+    // Anything after a return is unreachable and gets cleaned up by the optimizer
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context.module.getContext(), "after.return", function));
+    return nullptr;
+}
+
+auto CallExprAst::get_callee(CodegenContext &context) -> llvm::Function* {
+    const bool is_defined = context.defined_functions.contains(m_callee);
+    if (llvm::Function *callee = context.module.getFunction(is_defined ? CodegenContext::body_name(m_callee) : m_callee);
+        callee != nullptr) {
+        return callee;
+    }
+
+    auto prototype = context.prototypes.find(m_callee);
+    if (prototype == context.prototypes.end()) {
+        throw std::runtime_error("Unknown function referenced: " + m_callee);
+    }
+    return llvm::cast<llvm::Function>(prototype->second->generate_code(context));
+}
+
+auto CallExprAst::generate_args(CodegenContext &context, llvm::Function *callee) -> std::vector<llvm::Value*> {
+    std::vector<llvm::Value*> args;
+    std::unordered_set<std::string> passed_arrays;
+    for (auto &arg : m_args) {
+        auto *variable = dynamic_cast<VariableExprAst*>(arg.get());
+        auto array = variable != nullptr ? context.arrays.find(variable->get_name()) : context.arrays.end();
+        if (array != context.arrays.end()) {
+            // Array parameters are noalias, distinct array names never overlap since
+            // arrays only come in as parameters themselves
+            if (!passed_arrays.insert(array->first).second) {
+                throw std::runtime_error("Array " + array->first + " is passed more than once to " + m_callee +
+                                         ", arrays passed to one call must not overlap");
+            }
+            args.push_back(array->second.data);
+            args.push_back(array->second.length);
+        }
+        else {
+            args.push_back(arg->generate_code(context));
+        }
+    }
+
+    if (args.size() != callee->arg_size()) {
+        throw std::runtime_error("Incorrect number of arguments passed to " + m_callee);
+    }
+    for (size_t i = 0; i < args.size(); ++i) {
+        args[i] = context.convert(args[i], callee->getArg(static_cast<unsigned>(i))->getType());
+    }
+    return args;
+}
+
+auto CallExprAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    llvm::Function *callee = get_callee(context);
+    std::vector<llvm::Value*> args = generate_args(context, callee);
+
+    llvm::CallInst *call = context.builder.CreateCall(callee, args, callee->getReturnType()->isVoidTy() ? "" : "calltmp");
+    call->setCallingConv(callee->getCallingConv());
+    if (!context.tail_calls) {
+        call->setTailCallKind(llvm::CallInst::TCK_NoTail);
+    }
+    return call;
+}
+
+auto CallExprAst::generate_tail_call(CodegenContext &context) -> llvm::Value* {
+    auto &builder = context.builder;
+    llvm::Function *function = builder.GetInsertBlock()->getParent();
+    llvm::Function *callee = get_callee(context);
+    std::vector<llvm::Value*> args = generate_args(context, callee);
+
+    // Self-recursion becomes a loop as long as the arrays are passed through unchanged,
+    // all arguments are evaluated above before any slot is overwritten
+    bool can_loop = callee == function && context.tail_recursion_block != nullptr;
+    for (size_t i = 0; can_loop && i < args.size(); ++i) {
+        can_loop = context.argument_slots[i] != nullptr || args[i] == function->getArg(static_cast<unsigned>(i));
+    }
+    if (can_loop) {
+        for (size_t i = 0; i < args.size(); ++i) {
+            if (context.argument_slots[i] != nullptr) {
+                builder.CreateStore(args[i], context.argument_slots[i]);
+            }
+        }
+        builder.CreateBr(context.tail_recursion_block);
+    }
+    else {
+        llvm::CallInst *call = builder.CreateCall(callee, args, callee->getReturnType()->isVoidTy() ? "" : "calltmp");
+        call->setCallingConv(callee->getCallingConv());
+
+        // Matching signatures make the tail call mandatory, otherwise tailcc still
+        // guarantees it for calls between Quark functions
+        const bool same_signature = callee->getFunctionType() == function->getFunctionType()
+                                    && callee->getCallingConv() == function->getCallingConv();
+        call->setTailCallKind(same_signature ? llvm::CallInst::TCK_MustTail : llvm::CallInst::TCK_Tail);
+
+        if (function->getReturnType()->isVoidTy()) {
+            builder.CreateRetVoid();
+        }
+        else {
+            builder.CreateRet(context.convert(call, function->getReturnType()));
+        }
+    }
+
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context.module.getContext(), "after.return", function));
+    return nullptr;
+}
+
+auto PrototypeAst::function_type(CodegenContext &context) const -> llvm::FunctionType* {
+    std::vector<llvm::Type*> param_types;
+    for (const QuarkType type : m_arg_types) {
+        param_types.push_back(context.get_type(type));
+        if (CodegenContext::is_array(type)) {
+            param_types.push_back(context.builder.getInt64Ty());
+        }
+    }
+    return llvm::FunctionType::get(context.get_return_type(m_return_type), param_types, false);
+}
+
+auto PrototypeAst::create_function(CodegenContext &context, const std::string &symbol) -> llvm::Function* {
+    llvm::Function *function = llvm::Function::Create(function_type(context), llvm::Function::ExternalLinkage,
+                                                      symbol, context.module);
+
+    unsigned param = 0;
+    for (size_t i = 0; i < m_args.size(); ++i) {
+        function->getArg(param)->setName(m_args[i]);
+        if (CodegenContext::is_array(m_arg_types[i])) {
+            // Arrays never overlap and never escape, which is what lets the vectorizer
+            // skip runtime alias checks
+            llvm::Type *element_type = context.get_type(CodegenContext::element_type(m_arg_types[i]));
+            function->addParamAttr(param, llvm::Attribute::NoAlias);
+            function->addParamAttr(param, llvm::Attribute::NoCapture);
+            function->addParamAttr(param, llvm::Attribute::getWithAlignment(
+                context.module.getContext(), context.module.getDataLayout().getABITypeAlign(element_type)));
+            function->getArg(++param)->setName(m_args[i] + ".length");
+        }
+        ++param;
+    }
+
+    return function;
+}
+
+auto PrototypeAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    if (!context.defined_functions.contains(m_name)) {
+        return create_function(context, m_name);
+    }
+
+    // The body is only called from Quark code, possibly in another partition or batch
+    llvm::Function *function = create_function(context, CodegenContext::body_name(m_name));
+    if (context.tail_calls) {
+        function->setCallingConv(llvm::CallingConv::Tail);
+    }
+    function->setVisibility(llvm::GlobalValue::HiddenVisibility);
+    return function;
+}
+
+auto PrototypeAst::generate_entry(CodegenContext &context) -> llvm::Function* {
+    if (llvm::Function *entry = context.module.getFunction(m_name); entry != nullptr) {
+        return entry;
+    }
+    return create_function(context, m_name);
+}
+
+auto FunctionAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    auto &builder = context.builder;
+
+    const std::string &name = m_prototype->get_name();
+    context.defined_functions.insert(name);
+    llvm::Function *function = context.module.getFunction(CodegenContext::body_name(name));
+    if (function == nullptr) {
+        function = llvm::cast<llvm::Function>(m_prototype->generate_code(context));
+    }
+    llvm::Function *entry = m_prototype->generate_entry(context);
+    if (!function->empty() || !entry->empty()) {
+        throw std::runtime_error("Function cannot be redefined: " + name);
+    }
+    // A call may have declared the body from another prototype of the same name
+    llvm::FunctionType *function_type = m_prototype->function_type(context);
+    if (function->getFunctionType() != function_type || entry->getFunctionType() != function_type) {
+        throw std::runtime_error("Conflicting declaration of function: " + name);
+    }
+
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context.module.getContext(), "entry", function));
+    context.named_values.clear();
+    context.arrays.clear();
+    context.argument_slots.assign(function->arg_size(), nullptr);
+
+    const auto &args = m_prototype->get_args();
+    const auto &arg_types = m_prototype->get_arg_types();
+    auto *arg = function->arg_begin();
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (CodegenContext::is_array(arg_types[i])) {
+            llvm::Value *data = arg++;
+            llvm::Value *length = arg++;
+            context.arrays[args[i]] = {
+                .data = data, .length = length, .element_type = CodegenContext::element_type(arg_types[i])
+            };
+            continue;
+        }
+        llvm::AllocaInst *alloca = context.create_entry_block_alloca(function, args[i], arg->getType());
+        builder.CreateStore(arg, alloca);
+        context.named_values[args[i]] = alloca;
+        context.argument_slots[arg->getArgNo()] = alloca;
+        ++arg;
+    }
+
+    // The body starts in its own block so self-recursive tail calls can loop back to it
+    context.tail_recursion_block = llvm::BasicBlock::Create(context.module.getContext(), "tailrecurse", function);
+    builder.CreateBr(context.tail_recursion_block);
+    builder.SetInsertPoint(context.tail_recursion_block);
+
+    m_body->generate_code(context);
+    if (builder.GetInsertBlock()->getTerminator() == nullptr) {
+        if (function->getReturnType()->isVoidTy()) {
+            builder.CreateRetVoid();
+        }
+        else {
+            builder.CreateRet(llvm::Constant::getNullValue(function->getReturnType()));
+        }
+    }
+
+    context.tail_recursion_block = nullptr;
+    if (llvm::verifyFunction(*function, &llvm::errs())) {
+        function->eraseFromParent();
+        throw std::runtime_error("Generated invalid code for function: " + name);
+    }
+
+    // The entry point only forwards its arguments. The body is not inlined into it, so every
+    // function is optimized and emitted once
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context.module.getContext(), "entry", entry));
+    std::vector<llvm::Value*> entry_args;
+    for (llvm::Argument &entry_arg : entry->args()) {
+        entry_args.push_back(&entry_arg);
+    }
+    llvm::CallInst *call = builder.CreateCall(function, entry_args);
+    call->setCallingConv(function->getCallingConv());
+    call->setTailCall();
+    call->addFnAttr(llvm::Attribute::NoInline);
+    if (entry->getReturnType()->isVoidTy()) {
+        builder.CreateRetVoid();
+    }
+    else {
+        builder.CreateRet(call);
+    }
+    return function;
+}
+
+auto ImportAst::generate_code(CodegenContext &/*context*/) -> llvm::Value* {
+    // Imported modules are resolved at link time
+    return nullptr;
+}
+
+auto ModuleAst::generate_code(CodegenContext &context) -> llvm::Value* {
+    for (auto &import : m_imports) {
+        import->generate_code(context);
+    }
+    for (auto &prototype : m_prototypes) {
+        context.prototypes[prototype->get_name()] = prototype.get();
+    }
+    for (auto &function : m_functions) {
+        context.defined_functions.insert(function->get_prototype().get_name());
+    }
+    for (auto &global : m_global_variables) {
+        new llvm::GlobalVariable(context.module, context.builder.getDoubleTy(), false,
+                                 llvm::GlobalValue::InternalLinkage,
+                                 llvm::ConstantFP::get(context.builder.getDoubleTy(), 0.0),
+                                 global->get_name());
+    }
+    for (auto &function : m_functions) {
+        function->generate_code(context);
+    }
+    return nullptr;
+}
@@ -0,0 +1,71 @@
+#include "compiler.hpp"
+#include "codegen.hpp"
+#include "driver.hpp"
+#include "lexer.hpp"
+#include "linker.hpp"
+#include "parser.hpp"
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+CompilerInstance::CompilerInstance(BackendOptions options, std::size_t max_memory)
+: m_backend(std::move(options)), m_max_memory(max_memory) {}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+auto CompilerInstance::compile(const std::string &source, const std::string &name) const
+    -> std::unique_ptr<llvm::MemoryBuffer> {
+    if (m_max_memory > 0) {
+        ObjectLinker objects;
+        StreamingCompiler compiler(m_backend, m_max_memory);
+        compiler.compile(source, name, objects);
+        return objects.link_to_buffer();
+    }
+
+    QuarkParser parser(std::make_unique<Lexer>(source));
+    parser.parse_code();
+
+    // Every compilation gets its own context, so nothing accumulates in a long running process
+    llvm::LLVMContext context;
+    llvm::Module module(name, context);
+    m_backend.prepare_module(module);
+
+    CodegenContext codegen(module);
+    codegen.tail_calls = m_backend.options().tail_calls;
+    parser.get_module_ast()->generate_code(codegen);
+    return QuarkBackend::merge_objects(m_backend.compile_to_buffers(module));
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void CompilerInstance::compile_file(const std::string &input_file, const std::string &output_file) const {
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> input = llvm::MemoryBuffer::getFile(input_file);
+    if (!input) {
+        throw std::runtime_error("Failed to open input file " + input_file + ": " + input.getError().message());
+    }
+
+    // The batches are linked straight into the output instead of being read back first
+    if (m_max_memory > 0) {
+        ObjectLinker objects;
+        StreamingCompiler compiler(m_backend, m_max_memory);
+        compiler.compile((*input)->getBuffer().str(), input_file, objects);
+        objects.link(output_file);
+        return;
+    }
+
+    const std::unique_ptr<llvm::MemoryBuffer> object = compile((*input)->getBuffer().str(), input_file);
+
+    std::error_code error_code;
+    llvm::raw_fd_ostream dest(output_file, error_code, llvm::sys::fs::OF_None);
+    if (error_code) {
+        throw std::runtime_error("Failed to open output file " + output_file + ": " + error_code.message());
+    }
+    dest << object->getBuffer();
+}
@@ -0,0 +1,296 @@
+#include "daemon.hpp"
+#include "utils.hpp"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <llvm/Support/Threading.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr int LISTEN_BACKLOG = 64;
+constexpr size_t READ_CHUNK_SIZE = 4096;
+constexpr size_t QUEUED_CONNECTIONS_PER_WORKER = 4;
+
+auto system_error(const std::string &msg) -> std::runtime_error {
+    return std::runtime_error(msg + ": " + std::strerror(errno));
+}
+
+auto socket_address(const std::string &socket_path) -> sockaddr_un {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long: " + socket_path);
+    }
+    std::copy(socket_path.begin(), socket_path.end(), std::begin(address.sun_path));
+    return address;
+}
+
+// The socket API takes every address family through sockaddr
+auto as_sockaddr(const sockaddr_un &address) -> const sockaddr* {
+    return reinterpret_cast<const sockaddr*>(&address); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+}
+
+// A socket file is only replaced once no server answers on it anymore, anything else
+// at the path is left alone
+void remove_stale_socket(const std::string &socket_path, const sockaddr_un &address) {
+    struct stat status{};
+    if (::lstat(socket_path.c_str(), &status) < 0) {
+        if (errno == ENOENT) {
+            return;
+        }
+        throw system_error("Failed to inspect " + socket_path);
+    }
+    if (!S_ISSOCK(status.st_mode)) {
+        throw std::runtime_error(socket_path + " exists and is not a socket");
+    }
+
+    const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) {
+        throw system_error("Failed to create socket");
+    }
+    const bool refused = ::connect(probe, as_sockaddr(address), sizeof(address)) < 0 && errno == ECONNREFUSED;
+    ::close(probe);
+    if (!refused) {
+        throw std::runtime_error("Another server is already listening on " + socket_path);
+    }
+
+    if (::unlink(socket_path.c_str()) < 0) {
+        throw system_error("Failed to remove stale socket " + socket_path);
+    }
+}
+
+void write_all(int socket_fd, const std::string &data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t result = ::send(socket_fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw system_error("Failed to write to socket");
+        }
+        written += static_cast<size_t>(result);
+    }
+}
+
+// Reads until the peer closes its end or lines newlines have been read
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+auto read_lines(int socket_fd, size_t lines) -> std::string {
+    std::string data;
+    std::array<char, READ_CHUNK_SIZE> buffer{};
+    while (static_cast<size_t>(std::count(data.begin(), data.end(), '\n')) < lines) {
+        const ssize_t result = ::read(socket_fd, buffer.data(), buffer.size());
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw system_error("Failed to read from socket");
+        }
+        if (result == 0) {
+            break;
+        }
+        data.append(buffer.data(), static_cast<size_t>(result));
+    }
+    return data;
+}
+
+// Accepted connections waiting for a worker. push blocks while the queue is full, so the
+// server stops accepting and further clients wait in the listen backlog
+class ConnectionQueue {
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::deque<int> m_connections;
+    size_t m_capacity;
+    bool m_closed = false;
+
+public:
+    explicit ConnectionQueue(size_t capacity) : m_capacity(capacity) {}
+
+    void wait_for_space() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(lock, [this] { return m_connections.size() < m_capacity; });
+    }
+
+    void push(int connection) {
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_connections.push_back(connection);
+        }
+        m_changed.notify_all();
+    }
+
+    // Returns -1 once the queue is closed and empty
+    auto pop() -> int {
+        int connection = -1;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock, [this] { return !m_connections.empty() || m_closed; });
+            if (m_connections.empty()) {
+                return -1;
+            }
+            connection = m_connections.front();
+            m_connections.pop_front();
+        }
+        m_changed.notify_all();
+        return connection;
+    }
+
+    void close() {
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_changed.notify_all();
+    }
+};
+
+} // namespace
+
+CompileServer::CompileServer(const CompilerInstance &compiler, std::string socket_path, unsigned workers)
+: m_compiler(compiler), m_socket_path(std::move(socket_path)),
+  m_workers(llvm::hardware_concurrency(workers).compute_thread_count()) {
+    const sockaddr_un address = socket_address(m_socket_path);
+
+    remove_stale_socket(m_socket_path, address);
+
+    m_socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_socket < 0) {
+        throw system_error("Failed to create socket");
+    }
+
+    if (::bind(m_socket, as_sockaddr(address), sizeof(address)) < 0 ||
+        ::listen(m_socket, LISTEN_BACKLOG) < 0) {
+        const std::runtime_error error = system_error("Failed to listen on " + m_socket_path);
+        ::close(m_socket);
+        throw error;
+    }
+}
+
+CompileServer::~CompileServer() {
+    ::close(m_socket);
+    ::unlink(m_socket_path.c_str());
+}
+
+void CompileServer::handle_connection(int connection) const {
+    std::string reply = "ok\n";
+    try {
+        const std::string request = read_lines(connection, 2);
+        const size_t input_end = request.find('\n');
+        const size_t output_end = input_end == std::string::npos
+            ? std::string::npos
+            : request.find('\n', input_end + 1);
+        if (output_end == std::string::npos) {
+            throw std::runtime_error("Malformed request");
+        }
+
+        const std::string input_file = request.substr(0, input_end);
+        const std::string output_file = request.substr(input_end + 1, output_end - input_end - 1);
+        m_compiler.compile_file(input_file, output_file);
+    }
+    catch (const std::exception &error) {
+        reply = "error: " + std::string(error.what()) + "\n";
+        QuarkLogger::get_instance()->error(error.what());
+    }
+
+    try {
+        write_all(connection, reply);
+    }
+    catch (const std::exception &error) {
+        QuarkLogger::get_instance()->error(error.what());
+    }
+    ::close(connection);
+}
+
+void CompileServer::serve() const {
+    ConnectionQueue queue(static_cast<size_t>(m_workers) * QUEUED_CONNECTIONS_PER_WORKER);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < m_workers; ++i) {
+        workers.emplace_back([this, &queue] {
+            for (int connection = queue.pop(); connection >= 0; connection = queue.pop()) {
+                handle_connection(connection);
+            }
+        });
+    }
+
+    // The workers finish the queued requests before an accept error is rethrown
+    std::exception_ptr error;
+    try {
+        while (true) {
+            queue.wait_for_space();
+            const int connection = ::accept4(m_socket, nullptr, nullptr, SOCK_CLOEXEC);
+            if (connection < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                throw system_error("Failed to accept connection");
+            }
+            queue.push(connection);
+        }
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+
+    queue.close();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    std::rethrow_exception(error);
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void request_compile(const std::string &socket_path, const std::string &input_file,
+                     const std::string &output_file) {
+    const sockaddr_un address = socket_address(socket_path);
+
+    const int connection = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connection < 0) {
+        throw system_error("Failed to create socket");
+    }
+
+    std::string reply;
+    try {
+        if (::connect(connection, as_sockaddr(address), sizeof(address)) < 0) {
+            throw system_error("Failed to connect to " + socket_path);
+        }
+        write_all(connection, std::filesystem::absolute(input_file).string() + "\n" +
+                              std::filesystem::absolute(output_file).string() + "\n");
+        reply = read_lines(connection, 1);
+    }
+    catch (...) {
+        ::close(connection);
+        throw;
+    }
+    ::close(connection);
+
+    if (reply != "ok\n") {
+        const std::string prefix = "error: ";
+        if (reply.starts_with(prefix)) {
+            reply = reply.substr(prefix.size());
+        }
+        while (!reply.empty() && reply.back() == '\n') {
+            reply.pop_back();
+        }
+        throw std::runtime_error(reply.empty() ? "Compile server closed the connection" : reply);
+    }
+}
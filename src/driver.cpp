@@ -0,0 +1,82 @@
+#include "driver.hpp"
+#include "lexer.hpp"
+#include "utils.hpp"
+
+#include <llvm/IR/Function.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace {
+
+// Heap used per IR instruction of a batch while it is optimized. Unoptimized IR takes
+// about 275 bytes per instruction, the optimizer peaks at about 2.7 KiB on generated modules
+constexpr std::size_t BYTES_PER_INSTRUCTION = 3072;
+
+} // namespace
+
+void StreamingCompiler::start_batch(const std::string &name) {
+    // The prototypes are carried over, everything else of the previous batch is freed
+    auto prototypes = m_codegen != nullptr ? std::move(m_codegen->prototypes)
+                                           : std::unordered_map<std::string, PrototypeAst*>();
+    auto defined_functions = m_codegen != nullptr ? std::move(m_codegen->defined_functions)
+                                                  : std::unordered_set<std::string>();
+    m_codegen.reset();
+    m_module.reset();
+    m_context.reset();
+
+    m_context = std::make_unique<llvm::LLVMContext>();
+    m_module = std::make_unique<llvm::Module>(name + "." + std::to_string(m_batches), *m_context);
+    m_backend.prepare_module(*m_module);
+    m_codegen = std::make_unique<CodegenContext>(*m_module);
+    m_codegen->tail_calls = m_backend.options().tail_calls;
+    m_codegen->prototypes = std::move(prototypes);
+    m_codegen->defined_functions = std::move(defined_functions);
+    m_batch_functions = 0;
+    m_batch_instructions = 0;
+}
+
+void StreamingCompiler::flush_batch(ObjectLinker &objects) {
+    objects.add(*m_backend.compile_to_buffer(*m_module));
+    ++m_batches;
+    QuarkLogger::get_instance()->info("Emitted batch of " + std::to_string(m_batch_functions) + " functions");
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void StreamingCompiler::compile(const std::string &source, const std::string &name, ObjectLinker &objects) {
+    QuarkParser declarations(std::make_unique<Lexer>(source));
+    declarations.parse_declarations();
+
+    // Nothing of an earlier compilation is carried into the first batch
+    m_codegen.reset();
+    m_batches = 0;
+    start_batch(name);
+    for (const auto &prototype : declarations.get_prototypes()) {
+        m_codegen->prototypes[prototype->get_name()] = prototype.get();
+    }
+    m_codegen->defined_functions.insert(declarations.get_defined_functions().begin(),
+                                        declarations.get_defined_functions().end());
+
+    QuarkParser parser(std::make_unique<Lexer>(source));
+    while (auto function = parser.parse_next_function()) {
+        auto *body = llvm::cast<llvm::Function>(function->generate_code(*m_codegen));
+        const llvm::Function *entry = m_module->getFunction(function->get_prototype().get_name());
+        m_batch_instructions += body->getInstructionCount() + entry->getInstructionCount();
+        ++m_batch_functions;
+        function.reset();
+
+        if (m_batch_instructions * BYTES_PER_INSTRUCTION > m_max_memory) {
+            flush_batch(objects);
+            start_batch(name);
+        }
+    }
+
+    // An empty file still produces an (empty) object
+    if (m_batch_functions > 0 || m_batches == 0) {
+        flush_batch(objects);
+    }
+}
@@ -86,10 +86,11 @@ inline void Lexer::m_skip_block_comment() {
 void Lexer::m_skip_whitespace_and_comments() {
     while(true) {
         m_skip_whitespace();
-        if(m_pos + 2 < m_source.size() && m_source.compare(m_pos, 2, "//") == 0) {
+        if(m_pos + 1 < m_source.size() && m_source.compare(m_pos, 2, "//") == 0) {
             m_skip_inline_comment();
         }
-        else if(m_pos + 2 < m_source.size() && m_source.compare(m_pos, 2, "/*") == 0) {
+        else if(m_pos + 1 < m_source.size() && m_source.compare(m_pos, 2, "/*") == 0) {
+            m_pos += 2;
             m_skip_block_comment();
         }
         else {
@@ -111,12 +112,8 @@ auto Lexer::m_read_single_char_token() noexcept -> Token {
         case '+': return {.type = TokenType::PLUS, .value="+"};
         case '-': return {.type = TokenType::MINUS, .value="-"};
         case '*': return {.type = TokenType::ASTERISK, .value="*"};
-        case '/': {
-            if (m_pos < m_source.size() && m_source[m_pos] != '/' && m_source[m_pos] != '*') {
-                return {.type = TokenType::SLASH, .value="/"};
-            }
-            break;
-        }
+        // Comments were already skipped, so this is always a division
+        case '/': return {.type = TokenType::SLASH, .value="/"};
         case '=': return {.type = TokenType::EQUALS, .value="="};
         case '<': return {.type = TokenType::LESS, .value="<"};
         case '>': return {.type = TokenType::GREATER, .value=">"};
@@ -238,6 +235,7 @@ auto Lexer::get_next_token() -> Token {
     m_skip_whitespace_and_comments();
 
     auto *logger = QuarkLogger::get_instance();
+    const bool log_tokens = logger->is_enabled(Level::INFO);
 
     if (m_pos >= m_source.size()) {
         logger->info("Finished lexing source code");
@@ -246,19 +244,25 @@ auto Lexer::get_next_token() -> Token {
 
     Token token = m_read_multi_char_token();
     if(token.type != TokenType::INVALID_TOKEN) {
-        logger->info("Found multi character token of type: " + token_to_string(token.type));
+        if (log_tokens) {
+            logger->info("Found multi character token of type: " + token_to_string(token.type));
+        }
         return token;
     }
 
     token = m_read_single_char_token();
     if(token.type != TokenType::INVALID_TOKEN) {
-        logger->info("Found single character token of type: " + token_to_string(token.type));
+        if (log_tokens) {
+            logger->info("Found single character token of type: " + token_to_string(token.type));
+        }
         return token;
     }
 
     token = m_read_literal();
     if(token.type != TokenType::INVALID_TOKEN) {
-        logger->info("Found literal of type: " + token_to_string(token.type));
+        if (log_tokens) {
+            logger->info("Found literal of type: " + token_to_string(token.type));
+        }
         return token;
     }
 
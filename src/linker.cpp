@@ -0,0 +1,90 @@
+#include "linker.hpp"
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+ObjectLinker::~ObjectLinker() {
+    if (!m_directory.empty()) {
+        llvm::sys::fs::remove_directories(m_directory);
+    }
+}
+
+void ObjectLinker::add(const llvm::MemoryBuffer &object) {
+    if (m_directory.empty()) {
+        llvm::SmallString<128> prefix;
+        llvm::sys::path::system_temp_directory(true, prefix);
+        llvm::sys::path::append(prefix, "quark");
+        if (const std::error_code error_code = llvm::sys::fs::createUniqueDirectory(prefix, m_directory)) {
+            throw std::runtime_error("Failed to create a temporary directory: " + error_code.message());
+        }
+    }
+
+    llvm::SmallString<128> object_file = m_directory;
+    llvm::sys::path::append(object_file, std::to_string(m_object_files.size()) + ".o");
+
+    std::error_code error_code;
+    llvm::raw_fd_ostream dest(object_file, error_code, llvm::sys::fs::OF_None);
+    if (error_code) {
+        throw std::runtime_error("Failed to write object " + object_file.str().str() + ": " + error_code.message());
+    }
+    dest << object.getBuffer();
+    m_object_files.push_back(object_file.str().str());
+}
+
+void ObjectLinker::link(const std::string &output_file) const {
+    if (m_object_files.empty()) {
+        throw std::runtime_error("No objects to link into " + output_file);
+    }
+    if (m_object_files.size() == 1) {
+        if (const std::error_code error_code = llvm::sys::fs::copy_file(m_object_files.front(), output_file)) {
+            throw std::runtime_error("Failed to write output file " + output_file + ": " + error_code.message());
+        }
+        return;
+    }
+
+    const llvm::ErrorOr<std::string> linker = llvm::sys::findProgramByName("ld");
+    if (!linker) {
+        throw std::runtime_error("Merging objects needs the system linker (ld): " + linker.getError().message());
+    }
+
+    std::vector<llvm::StringRef> args = { "ld", "-r", "-o", output_file };
+    for (const std::string &object_file : m_object_files) {
+        args.emplace_back(object_file);
+    }
+
+    std::string error_message;
+    const int result = llvm::sys::ExecuteAndWait(*linker, args, llvm::None, {}, 0, 0, &error_message);
+    if (result != 0) {
+        throw std::runtime_error("Failed to merge objects into " + output_file +
+                                 (error_message.empty() ? "" : ": " + error_message));
+    }
+}
+
+auto ObjectLinker::link_to_buffer() -> std::unique_ptr<llvm::MemoryBuffer> {
+    if (m_object_files.size() > 1) {
+        llvm::SmallString<128> output_file = m_directory;
+        llvm::sys::path::append(output_file, "linked.o");
+        link(output_file.str().str());
+        m_object_files = { output_file.str().str() };
+    }
+    if (m_object_files.empty()) {
+        throw std::runtime_error("No objects to link");
+    }
+
+    // Read rather than mapped, the file is removed with the directory
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> object =
+        llvm::MemoryBuffer::getFile(m_object_files.front(), false, false, true);
+    if (!object) {
+        throw std::runtime_error("Failed to read linked object: " + object.getError().message());
+    }
+    return std::move(*object);
+}
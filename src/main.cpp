@@ -1,11 +1,12 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
+#include <cstddef>
+#include <exception>
 
-#include "lexer.hpp"
+#include "backend.hpp"
+#include "compiler.hpp"
+#include "daemon.hpp"
 #include "utils.hpp"
-#include "constants.hpp"
 
 auto main(int argc, char* argv[]) -> int {
     if (argc == 1) {
@@ -15,6 +16,11 @@ auto main(int argc, char* argv[]) -> int {
 
     std::string input_file;
     std::string output_file;
+    BackendOptions backend_options;
+    std::size_t max_memory = 0;
+    std::string server_socket;
+    // The last option that only applies to a compilation in this process
+    std::string compile_option;
 
     for (int i = 1; i < argc; ++i) {
         const std::string arg = argv[i];
@@ -25,6 +31,63 @@ auto main(int argc, char* argv[]) -> int {
                 std::cerr << "Error: -o option requires an argument.\n";
                 return 1;
             }
+        } else if (arg == "--pgo-generate" || arg.starts_with("--pgo-generate=")) {
+            compile_option = arg;
+            if (backend_options.pgo_mode == PgoMode::USE) {
+                std::cerr << "Error: --pgo-generate cannot be combined with --pgo-use.\n";
+                return 1;
+            }
+            backend_options.pgo_mode = PgoMode::GENERATE;
+            backend_options.pgo_profile_file = arg == "--pgo-generate"
+                ? "default.profraw"
+                : arg.substr(std::string("--pgo-generate=").size());
+        } else if (arg == "-j") {
+            compile_option = arg;
+            if (i + 1 >= argc) {
+                std::cerr << "Error: -j option requires an argument.\n";
+                return 1;
+            }
+            try {
+                backend_options.threads = parse_count(argv[++i]);
+            } catch (const std::exception &) {
+                std::cerr << "Error: -j expects a number of threads.\n";
+                return 1;
+            }
+        } else if (arg.starts_with("--max-memory=")) {
+            compile_option = arg;
+            try {
+                max_memory = parse_size(arg.substr(std::string("--max-memory=").size()));
+            } catch (const std::exception &) {
+                std::cerr << "Error: --max-memory expects a size such as 512M.\n";
+                return 1;
+            }
+        } else if (arg.starts_with("-mcpu=")) {
+            compile_option = arg;
+            backend_options.cpu = arg.substr(std::string("-mcpu=").size());
+            if (backend_options.cpu.empty()) {
+                std::cerr << "Error: -mcpu option requires a CPU name.\n";
+                return 1;
+            }
+        } else if (arg.starts_with("--server=")) {
+            server_socket = arg.substr(std::string("--server=").size());
+        } else if (arg == "--no-tail-calls") {
+            compile_option = arg;
+            backend_options.tail_calls = false;
+        } else if (arg == "--vectorize-report") {
+            compile_option = arg;
+            backend_options.vectorize_report = true;
+        } else if (arg.starts_with("--pgo-use=")) {
+            compile_option = arg;
+            if (backend_options.pgo_mode == PgoMode::GENERATE) {
+                std::cerr << "Error: --pgo-use cannot be combined with --pgo-generate.\n";
+                return 1;
+            }
+            backend_options.pgo_mode = PgoMode::USE;
+            backend_options.pgo_profile_file = arg.substr(std::string("--pgo-use=").size());
+            if (backend_options.pgo_profile_file.empty()) {
+                std::cerr << "Error: --pgo-use option requires a profile file.\n";
+                return 1;
+            }
         } else {
             if (input_file.empty()) {
                 input_file = arg;
@@ -45,28 +108,35 @@ auto main(int argc, char* argv[]) -> int {
         return 1;
     }
 
-    // Read input file
-    std::ifstream input_stream(input_file);
-    if (!input_stream.is_open()) {
-        std::cerr << "Error: Failed to open input file: " << input_file << '\n';
-        return 1;
+    // A running quarkd compiles the file, this process does not initialize LLVM at all
+    if (!server_socket.empty()) {
+        if (!compile_option.empty()) {
+            std::cerr << "Error: " << compile_option << " cannot be combined with --server, "
+                         "quarkd compiles with the options it was started with.\n";
+            return 1;
+        }
+        try {
+            request_compile(server_socket, input_file, output_file);
+        } catch (const std::exception &error) {
+            std::cerr << "Error: " << error.what() << '\n';
+            return 1;
+        }
+        return 0;
     }
 
-    std::stringstream buffer;
-    buffer << input_stream.rdbuf();
+    // Compilation logic, with a memory budget the file is parsed and compiled one batch of
+    // functions at a time, otherwise it is parsed as a whole
+    try {
+        auto *logger = QuarkLogger::get_instance();
+        logger->info("Quark compilation has started...");
 
-    // Compilation logic
-    auto *logger = QuarkLogger::get_instance();
-    logger->info("Quark compilation has started...");
+        const CompilerInstance compiler(backend_options, max_memory);
+        compiler.compile_file(input_file, output_file);
 
-    Lexer lexer(buffer.str());
-    Token token = lexer.get_next_token();
-    while(token.type != TokenType::END_OF_FILE) {
-        token = lexer.get_next_token();
+        logger->info("Quark compilation done...");
+    } catch (const std::exception &error) {
+        std::cerr << "Error: " << error.what() << '\n';
+        return 1;
     }
-
-    logger->info("Quark lexing completed...");
-    logger->info("Quark compilation done...");
-
     return 0;
 }
@@ -1,9 +1,41 @@
 #include "parser.hpp"
 #include "constants.hpp"
+#include "lexer.hpp"
 
 #include <unordered_map>
 #include <memory>
 #include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Deeper nesting is rejected before the recursive descent (or the codegen and destruction
+// of the resulting AST) can overflow the stack
+constexpr unsigned MAX_NESTING_DEPTH = 1024;
+
+class NestingGuard {
+private:
+    unsigned &m_depth;
+
+public:
+    NestingGuard(unsigned &depth): m_depth(depth) {
+        if (m_depth >= MAX_NESTING_DEPTH) {
+            throw std::runtime_error("Syntax error: nesting is too deep");
+        }
+        ++m_depth;
+    }
+    ~NestingGuard() { --m_depth; }
+
+    NestingGuard(const NestingGuard&) = delete;
+    auto operator=(const NestingGuard&) -> NestingGuard& = delete;
+    NestingGuard(NestingGuard&&) = delete;
+    auto operator=(NestingGuard&&) -> NestingGuard& = delete;
+};
+
+} // namespace
 
 const std::unordered_map<TokenType, uint8_t> QuarkParser::m_binop_priority = {
     { TokenType::EXPONENTIATION, 70 },
@@ -30,19 +62,475 @@ auto QuarkParser::get_token_priority(const TokenType &type) -> uint8_t {
     return iterator->second;
 }
 
+auto QuarkParser::is_type_keyword(TokenType type) -> bool {
+    switch (type) {
+        case TokenType::VOID_KEYWORD:
+        case TokenType::INT_KEYWORD:
+        case TokenType::FLOAT_KEYWORD:
+        case TokenType::BOOL_KEYWORD:
+        case TokenType::STRING_KEYWORD:
+        case TokenType::CHAR_KEYWORD:
+            return true;
+        default:
+            return false;
+    }
+}
+
 inline void QuarkParser::advance() {
     m_current_token = m_lexer->get_next_token();
 }
 
+void QuarkParser::expect(TokenType type) {
+    if (m_current_token.type != type) {
+        throw std::runtime_error("Syntax error: expected " + token_to_string(type) +
+                                 " but found " + token_to_string(m_current_token.type));
+    }
+    advance();
+}
+
+auto QuarkParser::parse_type() -> QuarkType {
+    QuarkType type = QuarkType::VOID;
+    switch (m_current_token.type) {
+        case TokenType::VOID_KEYWORD:
+            throw std::runtime_error("void can only be used as a return type");
+        case TokenType::INT_KEYWORD: type = QuarkType::INT; break;
+        case TokenType::FLOAT_KEYWORD: type = QuarkType::FLOAT; break;
+        case TokenType::BOOL_KEYWORD: type = QuarkType::BOOL; break;
+        case TokenType::STRING_KEYWORD:
+        case TokenType::CHAR_KEYWORD:
+            throw std::runtime_error("Type is not supported yet: " + m_current_token.value);
+        default:
+            throw std::runtime_error("Syntax error: expected a type but found " + token_to_string(m_current_token.type));
+    }
+    advance();
+
+    // int[] and float[]
+    if (m_current_token.type == TokenType::LBRACKET) {
+        advance();
+        expect(TokenType::RBRACKET);
+        if (type == QuarkType::INT) {
+            return QuarkType::INT_ARRAY;
+        }
+        if (type == QuarkType::FLOAT) {
+            return QuarkType::FLOAT_ARRAY;
+        }
+        throw std::runtime_error("Only int and float arrays are supported");
+    }
+    return type;
+}
+
+auto QuarkParser::parse_number() -> std::unique_ptr<ExprAst> {
+    std::unique_ptr<ExprAst> number;
+    try {
+        if (m_current_token.type == TokenType::INTEGER) {
+            number = std::make_unique<IntegerExprAst>(std::stoll(m_current_token.value));
+        }
+        else {
+            number = std::make_unique<NumberExprAst>(std::stod(m_current_token.value));
+        }
+    }
+    catch (const std::out_of_range &) {
+        throw std::runtime_error("Number out of range: " + m_current_token.value);
+    }
+    advance();
+    return number;
+}
+
+auto QuarkParser::parse_paren_expr() -> std::unique_ptr<ExprAst> {
+    expect(TokenType::LPAREN);
+    auto expression = parse_expression();
+    expect(TokenType::RPAREN);
+    return expression;
+}
+
+auto QuarkParser::parse_identifier() -> std::unique_ptr<ExprAst> {
+    std::string name = m_current_token.value;
+    advance();
+
+    // Array element (a[i])
+    if (m_current_token.type == TokenType::LBRACKET) {
+        advance();
+        auto index = parse_expression();
+        expect(TokenType::RBRACKET);
+        return std::make_unique<ArrayIndexExprAst>(std::move(name), std::move(index));
+    }
+
+    if (m_current_token.type != TokenType::LPAREN) {
+        return std::make_unique<VariableExprAst>(std::move(name));
+    }
+
+    // Function call
+    advance();
+    std::vector<std::unique_ptr<ExprAst>> args;
+    while (m_current_token.type != TokenType::RPAREN) {
+        args.push_back(parse_expression());
+        if (m_current_token.type != TokenType::COMMA) {
+            break;
+        }
+        advance();
+    }
+    expect(TokenType::RPAREN);
+
+    // len(a) is the length of an array
+    if (name == "len" && args.size() == 1) {
+        if (auto *array = dynamic_cast<VariableExprAst*>(args.front().get()); array != nullptr) {
+            return std::make_unique<ArrayLengthExprAst>(array->get_name());
+        }
+    }
+    return std::make_unique<CallExprAst>(std::move(name), std::move(args));
+}
+
+auto QuarkParser::parse_primary() -> std::unique_ptr<ExprAst> {
+    const NestingGuard guard(m_depth);
+    switch (m_current_token.type) {
+        case TokenType::IDENTIFIER: return parse_identifier();
+        case TokenType::INTEGER:
+        case TokenType::FLOAT:
+            return parse_number();
+        case TokenType::LPAREN: return parse_paren_expr();
+        case TokenType::TRUE_KEYWORD:
+        case TokenType::FALSE_KEYWORD: {
+            const bool value = m_current_token.type == TokenType::TRUE_KEYWORD;
+            advance();
+            return std::make_unique<BoolExprAst>(value);
+        }
+        case TokenType::MINUS: {
+            advance();
+            return std::make_unique<BinaryExprAst>(TokenType::MINUS, std::make_unique<IntegerExprAst>(0), parse_primary());
+        }
+        case TokenType::EXCLAMATION_MARK: {
+            advance();
+            return std::make_unique<BinaryExprAst>(TokenType::EQUALS_EQUALS, parse_primary(),
+                                                   std::make_unique<IntegerExprAst>(0));
+        }
+        default:
+            throw std::runtime_error("Syntax error: unexpected " + token_to_string(m_current_token.type));
+    }
+}
+
+auto QuarkParser::parse_binop_rhs(int expr_prec, std::unique_ptr<ExprAst> LHS) -> std::unique_ptr<ExprAst> {
+    // Every operator nests the expression built so far one level deeper
+    unsigned operators = 0;
+    while (true) {
+        const int token_prec = get_token_priority(m_current_token.type);
+        if (token_prec < expr_prec) {
+            return LHS;
+        }
+        if (m_depth + ++operators > MAX_NESTING_DEPTH) {
+            throw std::runtime_error("Syntax error: expression is too long");
+        }
+
+        const TokenType oper = m_current_token.type;
+        advance();
+        auto RHS = parse_primary();
+
+        // Bind tighter operators on the right first
+        if (token_prec < get_token_priority(m_current_token.type)) {
+            RHS = parse_binop_rhs(token_prec + 1, std::move(RHS));
+        }
+        LHS = std::make_unique<BinaryExprAst>(oper, std::move(LHS), std::move(RHS));
+    }
+}
+
+auto QuarkParser::parse_expression() -> std::unique_ptr<ExprAst> {
+    const NestingGuard guard(m_depth);
+    auto LHS = parse_binop_rhs(1, parse_primary());
+
+    // Assignment is right associative and binds loosest
+    if (m_current_token.type == TokenType::EQUALS) {
+        advance();
+        return std::make_unique<BinaryExprAst>(TokenType::EQUALS, std::move(LHS), parse_expression());
+    }
+    return LHS;
+}
+
+auto QuarkParser::parse_return_type() -> QuarkType {
+    if (m_current_token.type == TokenType::VOID_KEYWORD) {
+        advance();
+        return QuarkType::VOID;
+    }
+
+    const QuarkType type = parse_type();
+    if (type == QuarkType::INT_ARRAY || type == QuarkType::FLOAT_ARRAY) {
+        throw std::runtime_error("Functions cannot return arrays");
+    }
+    return type;
+}
+
+auto QuarkParser::parse_var_decl() -> std::unique_ptr<ExprAst> {
+    const QuarkType type = parse_type();
+    if (m_current_token.type != TokenType::IDENTIFIER) {
+        throw std::runtime_error("Syntax error: expected a variable name");
+    }
+    std::string name = m_current_token.value;
+    advance();
+
+    std::unique_ptr<ExprAst> init;
+    if (m_current_token.type == TokenType::EQUALS) {
+        advance();
+        init = parse_expression();
+    }
+    return std::make_unique<VarDeclExprAst>(std::move(name), type, std::move(init));
+}
+
+auto QuarkParser::parse_block() -> std::unique_ptr<ExprAst> {
+    expect(TokenType::LBRACE);
+    std::vector<std::unique_ptr<ExprAst>> body;
+    while (m_current_token.type != TokenType::RBRACE) {
+        if (m_current_token.type == TokenType::END_OF_FILE) {
+            throw std::runtime_error("Syntax error: unterminated block");
+        }
+        if (m_current_token.type == TokenType::SEMICOLON) {
+            advance();
+            continue;
+        }
+        body.push_back(parse_statement());
+    }
+    advance();
+    return std::make_unique<BlockExprAst>(std::move(body));
+}
+
+auto QuarkParser::parse_if() -> std::unique_ptr<ExprAst> {
+    advance();
+    auto cond = parse_paren_expr();
+    auto then_branch = parse_statement();
+
+    std::unique_ptr<ExprAst> else_branch;
+    if (m_current_token.type == TokenType::ELSE_KEYWORD) {
+        advance();
+        else_branch = parse_statement();
+    }
+    return std::make_unique<IfExprAst>(std::move(cond), std::move(then_branch), std::move(else_branch));
+}
+
+auto QuarkParser::parse_for() -> std::unique_ptr<ExprAst> {
+    advance();
+    expect(TokenType::LPAREN);
+
+    std::unique_ptr<ExprAst> init;
+    if (is_type_keyword(m_current_token.type)) {
+        init = parse_var_decl();
+    }
+    else if (m_current_token.type != TokenType::SEMICOLON) {
+        init = parse_expression();
+    }
+    expect(TokenType::SEMICOLON);
+
+    std::unique_ptr<ExprAst> cond;
+    if (m_current_token.type != TokenType::SEMICOLON) {
+        cond = parse_expression();
+    }
+    expect(TokenType::SEMICOLON);
+
+    std::unique_ptr<ExprAst> step;
+    if (m_current_token.type != TokenType::RPAREN) {
+        step = parse_expression();
+    }
+    expect(TokenType::RPAREN);
+
+    auto body = parse_statement();
+    return std::make_unique<ForExprAst>(std::move(init), std::move(cond), std::move(step), std::move(body));
+}
+
+auto QuarkParser::parse_while() -> std::unique_ptr<ExprAst> {
+    advance();
+    auto cond = parse_paren_expr();
+    auto body = parse_statement();
+    return std::make_unique<WhileExprAst>(std::move(cond), std::move(body));
+}
+
+auto QuarkParser::parse_return() -> std::unique_ptr<ExprAst> {
+    advance();
+    std::unique_ptr<ExprAst> value;
+    if (m_current_token.type != TokenType::SEMICOLON && m_current_token.type != TokenType::RBRACE) {
+        value = parse_expression();
+    }
+    return std::make_unique<ReturnExprAst>(std::move(value));
+}
+
+auto QuarkParser::parse_statement() -> std::unique_ptr<ExprAst> {
+    const NestingGuard guard(m_depth);
+    std::unique_ptr<ExprAst> statement;
+    switch (m_current_token.type) {
+        case TokenType::LBRACE: return parse_block();
+        case TokenType::IF_KEYWORD: return parse_if();
+        case TokenType::FOR_KEYWORD: return parse_for();
+        case TokenType::WHILE_KEYWORD: return parse_while();
+        case TokenType::RETURN_KEYWORD:
+            statement = parse_return();
+            break;
+        default:
+            statement = is_type_keyword(m_current_token.type) ? parse_var_decl() : parse_expression();
+            break;
+    }
+
+    // The semicolon may be left out before a closing brace
+    if (m_current_token.type == TokenType::SEMICOLON) {
+        advance();
+    }
+    else if (m_current_token.type != TokenType::RBRACE) {
+        throw std::runtime_error("Syntax error: expected ; but found " + token_to_string(m_current_token.type));
+    }
+    return statement;
+}
+
+auto QuarkParser::parse_prototype() -> std::unique_ptr<PrototypeAst> {
+    // func is optional (int main())
+    if (m_current_token.type == TokenType::FUNC_KEYWORD) {
+        advance();
+    }
+    const QuarkType return_type = parse_return_type();
+
+    if (m_current_token.type != TokenType::IDENTIFIER) {
+        throw std::runtime_error("Syntax error: expected a function name");
+    }
+    std::string name = m_current_token.value;
+    advance();
+
+    expect(TokenType::LPAREN);
+    std::vector<std::string> args;
+    std::vector<QuarkType> arg_types;
+    while (m_current_token.type != TokenType::RPAREN) {
+        arg_types.push_back(parse_type());
+        if (m_current_token.type != TokenType::IDENTIFIER) {
+            throw std::runtime_error("Syntax error: expected an argument name");
+        }
+        args.push_back(m_current_token.value);
+        advance();
+
+        if (m_current_token.type != TokenType::COMMA) {
+            break;
+        }
+        advance();
+    }
+    expect(TokenType::RPAREN);
+
+    return std::make_unique<PrototypeAst>(std::move(name), std::move(args), std::move(arg_types), return_type);
+}
+
+auto QuarkParser::parse_function() -> std::unique_ptr<FunctionAst> {
+    auto prototype = parse_prototype();
+
+    // A prototype on its own is a forward declaration
+    if (m_current_token.type == TokenType::SEMICOLON) {
+        advance();
+        declare(std::move(prototype), false);
+        return nullptr;
+    }
+
+    declare(std::make_unique<PrototypeAst>(*prototype), true);
+    auto body = parse_block();
+    return std::make_unique<FunctionAst>(std::move(prototype), std::move(body));
+}
+
+auto QuarkParser::parse_import() -> std::unique_ptr<ImportAst> {
+    advance();
+    if (m_current_token.type != TokenType::IDENTIFIER) {
+        throw std::runtime_error("Syntax error: expected a module name after import");
+    }
+    auto import = std::make_unique<ImportAst>(m_current_token.value);
+    advance();
+    expect(TokenType::SEMICOLON);
+    return import;
+}
+
+auto QuarkParser::parse_top_level_exp() -> std::unique_ptr<FunctionAst> {
+    switch (m_current_token.type) {
+        case TokenType::IMPORT_KEYWORD:
+            m_imports.push_back(parse_import());
+            return nullptr;
+        case TokenType::SEMICOLON:
+            advance();
+            return nullptr;
+        case TokenType::FUNC_KEYWORD:
+            return parse_function();
+        default:
+            if (is_type_keyword(m_current_token.type)) {
+                return parse_function();
+            }
+            throw std::runtime_error("Syntax error: unexpected " + token_to_string(m_current_token.type) + " at top level");
+    }
+}
+
 void QuarkParser::parse_code() {
-    while(true) {
-        switch(m_current_token.type) {
-            case TokenType::END_OF_FILE: [[unlikely]] return;
-            case TokenType::SEMICOLON:
-                advance();
-                break;
-            default:
-                break;
+    advance();
+
+    std::vector<std::unique_ptr<FunctionAst>> functions;
+    while (m_current_token.type != TokenType::END_OF_FILE) {
+        if (auto function = parse_top_level_exp()) {
+            functions.push_back(std::move(function));
+        }
+    }
+
+    m_module_ast = std::make_unique<ModuleAst>(std::move(m_prototypes), std::move(m_imports),
+                                               std::vector<std::unique_ptr<VariableExprAst>>(),
+                                               std::move(functions));
+}
+
+auto QuarkParser::parse_next_function() -> std::unique_ptr<FunctionAst> {
+    if (m_current_token.type == TokenType::INVALID_TOKEN) {
+        advance();
+    }
+
+    while (m_current_token.type != TokenType::END_OF_FILE) {
+        if (auto function = parse_top_level_exp()) {
+            return function;
+        }
+    }
+    return nullptr;
+}
+
+void QuarkParser::skip_block() {
+    expect(TokenType::LBRACE);
+    for (unsigned depth = 1; depth > 0; advance()) {
+        if (m_current_token.type == TokenType::END_OF_FILE) {
+            throw std::runtime_error("Syntax error: expected } but found the end of the file");
+        }
+        if (m_current_token.type == TokenType::LBRACE) {
+            ++depth;
+        }
+        else if (m_current_token.type == TokenType::RBRACE) {
+            --depth;
+        }
+    }
+}
+
+void QuarkParser::declare(std::unique_ptr<PrototypeAst> prototype, bool is_definition) {
+    const std::string &name = prototype->get_name();
+    auto [declaration, is_new] = m_declarations.try_emplace(name, prototype.get());
+    if (!is_new && !declaration->second->has_same_signature(*prototype)) {
+        throw std::runtime_error("Conflicting declaration of function: " + name);
+    }
+    if (is_definition && !m_defined_functions.insert(name).second) {
+        throw std::runtime_error("Function cannot be redefined: " + name);
+    }
+    m_prototypes.push_back(std::move(prototype));
+}
+
+void QuarkParser::parse_declarations() {
+    advance();
+
+    while (m_current_token.type != TokenType::END_OF_FILE) {
+        if (m_current_token.type == TokenType::IMPORT_KEYWORD) {
+            m_imports.push_back(parse_import());
+            continue;
+        }
+        if (m_current_token.type == TokenType::SEMICOLON) {
+            advance();
+            continue;
+        }
+        if (m_current_token.type != TokenType::FUNC_KEYWORD && !is_type_keyword(m_current_token.type)) {
+            throw std::runtime_error("Syntax error: unexpected " + token_to_string(m_current_token.type) + " at top level");
+        }
+
+        auto prototype = parse_prototype();
+        const bool is_definition = m_current_token.type != TokenType::SEMICOLON;
+        if (is_definition) {
+            skip_block();
+        }
+        else {
+            advance();
         }
+        declare(std::move(prototype), is_definition);
     }
 }
@@ -0,0 +1,108 @@
+#include "compiler.hpp"
+#include "daemon.hpp"
+#include "utils.hpp"
+
+#include <unistd.h>
+
+#include <csignal>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <string>
+
+namespace {
+
+// Read by the signal handler, set once before it is installed
+std::string socket_path; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+extern "C" void remove_socket_and_exit(int /*signal*/) {
+    ::unlink(socket_path.c_str());
+    ::_exit(0);
+}
+
+} // namespace
+
+auto main(int argc, char* argv[]) -> int {
+    BackendOptions backend_options;
+    std::size_t max_memory = 0;
+    unsigned workers = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-j") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: -j option requires an argument.\n";
+                return 1;
+            }
+            try {
+                backend_options.threads = parse_count(argv[++i]);
+            } catch (const std::exception &) {
+                std::cerr << "Error: -j expects a number of threads.\n";
+                return 1;
+            }
+        } else if (arg == "--workers") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --workers option requires an argument.\n";
+                return 1;
+            }
+            try {
+                workers = parse_count(argv[++i]);
+            } catch (const std::exception &) {
+                std::cerr << "Error: --workers expects a number of requests.\n";
+                return 1;
+            }
+        } else if (arg.starts_with("--max-memory=")) {
+            try {
+                max_memory = parse_size(arg.substr(std::string("--max-memory=").size()));
+            } catch (const std::exception &) {
+                std::cerr << "Error: --max-memory expects a size such as 512M.\n";
+                return 1;
+            }
+        } else if (arg.starts_with("-mcpu=")) {
+            backend_options.cpu = arg.substr(std::string("-mcpu=").size());
+            if (backend_options.cpu.empty()) {
+                std::cerr << "Error: -mcpu option requires a CPU name.\n";
+                return 1;
+            }
+        } else if (arg == "--no-tail-calls") {
+            backend_options.tail_calls = false;
+        } else if (arg == "--vectorize-report") {
+            backend_options.vectorize_report = true;
+        } else if (arg.starts_with("--pgo-use=")) {
+            backend_options.pgo_mode = PgoMode::USE;
+            backend_options.pgo_profile_file = arg.substr(std::string("--pgo-use=").size());
+            if (backend_options.pgo_profile_file.empty()) {
+                std::cerr << "Error: --pgo-use option requires a profile file.\n";
+                return 1;
+            }
+        } else if (socket_path.empty()) {
+            socket_path = arg;
+        } else {
+            std::cerr << "Error: Too many sockets specified.\n";
+            return 1;
+        }
+    }
+
+    if (socket_path.empty()) {
+        std::cerr << "Usage: quarkd <socket> [--workers <requests>] [-j <threads>] [--max-memory=<size>] "
+                     "[-mcpu=<cpu>] [--no-tail-calls] [--vectorize-report] [--pgo-use=<profile>]\n";
+        return 1;
+    }
+
+    // Per token messages would dominate the time of every request
+    QuarkLogger::get_instance()->set_level(Level::WARNING);
+
+    try {
+        const CompilerInstance compiler(backend_options, max_memory);
+        const CompileServer server(compiler, socket_path, workers);
+
+        std::signal(SIGINT, remove_socket_and_exit);
+        std::signal(SIGTERM, remove_socket_and_exit);
+        std::cout << "quarkd listening on " << socket_path << '\n' << std::flush;
+        server.serve();
+    } catch (const std::exception &error) {
+        std::cerr << "Error: " << error.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -1,22 +1,30 @@
 #include "utils.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <ios>
 #include <chrono>
 #include <ctime>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
 #include <memory>
 #include <mutex>
 #include <string>
 
+namespace {
+
+// Bit shifts of the K, M and G size suffixes
+constexpr unsigned KIB_SHIFT = 10;
+constexpr unsigned MIB_SHIFT = 20;
+constexpr unsigned GIB_SHIFT = 30;
+
+} // namespace
+
 std::unique_ptr<QuarkLogger> QuarkLogger::m_instance = nullptr;
 std::mutex QuarkLogger::m_mutex;
 
-QuarkLogger::QuarkLogger() {
-    log_file.open("quark.log", std::ios::app);
-    if (!log_file.is_open()) {
-        throw std::ios_base::failure("Failed to open log file");
-    }
-}
+QuarkLogger::QuarkLogger() = default;
 
 QuarkLogger::~QuarkLogger() {
     if (log_file.is_open()) {
@@ -44,10 +52,19 @@ auto QuarkLogger::level_to_string(Level level) -> std::string {
 }
 
 void QuarkLogger::log(Level level, const std::string& msg) {
+    if (!is_enabled(level)) {
+        return;
+    }
     const std::lock_guard<std::mutex> lock(m_mutex);
-    if (log_file.is_open()) {
-        log_file << "[" << get_time() << "] - [" << level_to_string(level) << "] " << msg << '\n';
+
+    // The log file is only opened once something is logged
+    if (!log_file.is_open()) {
+        log_file.open("quark.log", std::ios::app);
+        if (!log_file.is_open()) {
+            throw std::ios_base::failure("Failed to open log file");
+        }
     }
+    log_file << "[" << get_time() << "] - [" << level_to_string(level) << "] " << msg << '\n';
     std::cout << "[" << get_time() << "] - [" << level_to_string(level) << "] " << msg << '\n';
 }
 
@@ -67,10 +84,53 @@ void QuarkLogger::error(const std::string& msg) {
     log(Level::ERROR, msg);
 }
 
+void QuarkLogger::set_level(Level level) {
+    m_level.store(level, std::memory_order_relaxed);
+}
+
 auto QuarkLogger::get_instance() -> QuarkLogger* {
-    const std::lock_guard<std::mutex> lock(m_mutex);
-    if (m_instance == nullptr) {
-        m_instance = std::make_unique<QuarkLogger>();
-    }
+    // Called for every token, only the first call pays for the synchronization
+    static std::once_flag created;
+    std::call_once(created, [] { m_instance = std::make_unique<QuarkLogger>(); });
     return m_instance.get();
 }
+
+auto parse_size(const std::string &size) -> std::size_t {
+    // Digits only, std::stoull would accept a sign and wrap negative sizes around
+    const std::size_t suffix_pos = std::min(size.find_first_not_of("0123456789"), size.size());
+    if (suffix_pos == 0) {
+        throw std::invalid_argument("Invalid size: " + size);
+    }
+    const std::size_t value = std::stoull(size.substr(0, suffix_pos));
+    const std::string suffix = size.substr(suffix_pos);
+
+    unsigned shift = 0;
+    if (suffix == "K") {
+        shift = KIB_SHIFT;
+    }
+    else if (suffix == "M") {
+        shift = MIB_SHIFT;
+    }
+    else if (suffix == "G") {
+        shift = GIB_SHIFT;
+    }
+    else if (!suffix.empty()) {
+        throw std::invalid_argument("Invalid size suffix: " + suffix);
+    }
+
+    if (value > (std::numeric_limits<std::size_t>::max() >> shift)) {
+        throw std::out_of_range("Size is too large: " + size);
+    }
+    return value << shift;
+}
+
+auto parse_count(const std::string &count) -> unsigned {
+    if (count.empty() || count.find_first_not_of("0123456789") != std::string::npos) {
+        throw std::invalid_argument("Invalid count: " + count);
+    }
+    const unsigned long value = std::stoul(count);
+    if (value > std::numeric_limits<unsigned>::max()) {
+        throw std::out_of_range("Count is too large: " + count);
+    }
+    return static_cast<unsigned>(value);
+}
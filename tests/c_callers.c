@@ -0,0 +1,44 @@
+// Calls the Quark kernels through their C entry points
+#include <stdint.h>
+#include <stdio.h>
+
+int64_t sum(const int64_t *values, int64_t length);
+double dot(const double *a, int64_t a_length, const double *b, int64_t b_length);
+void saxpy(double a, const double *x, int64_t x_length, double *y, int64_t y_length);
+int64_t factorial(int64_t n, int64_t acc);
+
+#define LENGTH 1000
+
+int main(void) {
+    int64_t values[LENGTH];
+    double x[LENGTH];
+    double y[LENGTH];
+    int64_t expected_sum = 0;
+    for (int64_t i = 0; i < LENGTH; ++i) {
+        values[i] = i;
+        expected_sum += i;
+        x[i] = 1.0;
+        y[i] = (double)i;
+    }
+
+    if (sum(values, LENGTH) != expected_sum) {
+        fprintf(stderr, "sum returned %lld\n", (long long)sum(values, LENGTH));
+        return 1;
+    }
+    if (dot(x, LENGTH, x, LENGTH) != LENGTH) {
+        fprintf(stderr, "dot returned %f\n", dot(x, LENGTH, x, LENGTH));
+        return 1;
+    }
+    saxpy(2.0, x, LENGTH, y, LENGTH);
+    for (int64_t i = 0; i < LENGTH; ++i) {
+        if (y[i] != (double)i + 2.0) {
+            fprintf(stderr, "saxpy wrote %f at %lld\n", y[i], (long long)i);
+            return 1;
+        }
+    }
+    if (factorial(10, 1) != 3628800) {
+        fprintf(stderr, "factorial returned %lld\n", (long long)factorial(10, 1));
+        return 1;
+    }
+    return 0;
+}
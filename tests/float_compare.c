@@ -0,0 +1,41 @@
+// Compares the Quark float comparisons with C's
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+bool less(double a, double b);
+bool greater(double a, double b);
+bool less_equals(double a, double b);
+bool greater_equals(double a, double b);
+bool equals(double a, double b);
+bool not_equals(double a, double b);
+bool equals_itself(double a);
+bool is_true(double a);
+
+int main(void) {
+    const double values[] = { -1.0, 0.0, 1.0, INFINITY, -INFINITY, NAN };
+    const int count = sizeof(values) / sizeof(values[0]);
+    int failures = 0;
+
+    for (int i = 0; i < count; ++i) {
+        const double a = values[i];
+        if (equals_itself(a) != (a == a)) {
+            fprintf(stderr, "%f == itself\n", a);
+            ++failures;
+        }
+        if (is_true(a) != (a ? true : false)) {
+            fprintf(stderr, "%f as a condition\n", a);
+            ++failures;
+        }
+        for (int j = 0; j < count; ++j) {
+            const double b = values[j];
+            if (less(a, b) != (a < b) || greater(a, b) != (a > b) ||
+                less_equals(a, b) != (a <= b) || greater_equals(a, b) != (a >= b) ||
+                equals(a, b) != (a == b) || not_equals(a, b) != (a != b)) {
+                fprintf(stderr, "comparison of %f and %f differs from C\n", a, b);
+                ++failures;
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+#!/bin/sh
+# Builds a program without a profile, instruments it, trains it, merges the profile and
+# rebuilds it with the profile. The test fails when the profile is empty or the optimized
+# program is slower than the one built without it. The profile runtime comes with clang,
+# without clang and llvm-profdata the test is skipped.
+# Usage: pgo.sh <quark> <clang> <llvm-profdata> <work dir> <program.qrk>
+set -e
+
+quark=$1
+clang=$2
+profdata=$3
+work_dir=$4
+program=$5
+
+if ! command -v "$clang" > /dev/null 2>&1 || ! command -v "$profdata" > /dev/null 2>&1; then
+    echo "clang and llvm-profdata are required for profile-guided optimization"
+    exit 77
+fi
+
+mkdir -p "$work_dir"
+cd "$work_dir"
+rm -f pgo.profraw pgo.profdata
+ulimit -s 8192
+
+"$quark" "$program" -o plain.o > /dev/null
+"$clang" plain.o -o plain
+
+"$quark" "$program" -o instrumented.o --pgo-generate=pgo.profraw > /dev/null
+"$clang" -fprofile-generate instrumented.o -o instrumented
+./instrumented
+"$profdata" merge pgo.profraw -o pgo.profdata
+if ! "$profdata" show pgo.profdata | grep -q 'Total functions: [1-9]'; then
+    echo "pgo.profdata has no function counts" >&2
+    exit 1
+fi
+
+"$quark" "$program" -o optimized.o --pgo-use=pgo.profdata > /dev/null
+"$clang" optimized.o -o optimized
+
+# Fastest of three runs in milliseconds
+fastest() {
+    best=
+    for attempt in 1 2 3; do
+        start=$(date +%s%N)
+        "./$1"
+        end=$(date +%s%N)
+        time=$(( (end - start) / 1000000 ))
+        if [ -z "$best" ] || [ "$time" -lt "$best" ]; then
+            best=$time
+        fi
+    done
+    echo "$best"
+}
+
+plain_time=$(fastest plain)
+optimized_time=$(fastest optimized)
+echo "without profile: ${plain_time} ms, with profile: ${optimized_time} ms"
+
+# Timer noise is allowed for, a slower program means the profile was applied wrongly
+if [ "$optimized_time" -gt $(( plain_time * 11 / 10 + 20 )) ]; then
+    echo "the program built with the profile is slower" >&2
+    exit 1
+fi
@@ -0,0 +1,25 @@
+#!/bin/sh
+# Compiles a Quark program, links it with an optional C harness and runs it with the
+# common 8 MiB stack limit. The test passes when the program exits with 0.
+# Usage: run_program.sh <quark> <cc> <work dir> <program.qrk> <harness.c or ""> [quark flags...]
+set -e
+
+quark=$1
+cc=$2
+work_dir=$3
+program=$4
+harness=$5
+shift 5
+
+mkdir -p "$work_dir"
+cd "$work_dir"
+
+"$quark" "$program" -o program.o "$@" > /dev/null
+if [ -n "$harness" ]; then
+    "$cc" -O2 "$harness" program.o -o program -lm
+else
+    "$cc" program.o -o program -lm
+fi
+
+ulimit -s 8192
+./program
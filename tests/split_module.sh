@@ -0,0 +1,40 @@
+#!/bin/sh
+# Compiles a module large enough to be split into partitions and checks that the output is
+# still one relocatable object, a shared library built from it has to export every function.
+# The partitions do not depend on the number of threads, neither does the object
+# Usage: split_module.sh <quark> <cc> <work dir>
+set -e
+
+quark=$1
+cc=$2
+work_dir=$3
+functions=600
+
+mkdir -p "$work_dir"
+cd "$work_dir"
+
+i=0
+: > split.qrk
+while [ $i -lt $functions ]; do
+    printf 'func int f%d(int x) {\n    return x + %d;\n}\n\n' $i $i >> split.qrk
+    i=$((i + 1))
+done
+
+"$quark" split.qrk -o split.o -j 4 > /dev/null
+"$quark" split.qrk -o split_single_thread.o -j 1 > /dev/null
+if ! cmp -s split.o split_single_thread.o; then
+    echo "split.o depends on the number of threads" >&2
+    exit 1
+fi
+
+if [ "$(head -c 4 split.o | od -An -c | tr -d ' ')" != "177ELF" ]; then
+    echo "split.o is not an ELF object" >&2
+    exit 1
+fi
+
+"$cc" -shared split.o -o libsplit.so
+exported=$(nm -D --defined-only libsplit.so | grep -c ' T f[0-9]*$')
+if [ "$exported" -ne $functions ]; then
+    echo "libsplit.so exports $exported of $functions functions" >&2
+    exit 1
+fi